@@ -1,23 +1,38 @@
 #pragma once
 
-#include <sstream>
-#include <string>
+#include <cstdint>
 #include "Vec2.hpp"
 
+enum class ActionType : uint8_t { None, Start, End, Count };
+
+using ActionId = uint16_t;
+
+// ids the engine raises itself; every scene numbers its own actions from SceneFirst
+namespace EngineAction
+{
+	enum : ActionId
+	{
+		None = 0,
+		MouseMove,
+		MouseScroll,
+		SceneFirst
+	};
+}
+
 class Action
 {
 public:
-	std::string m_name = "NONE";
-	std::string m_type = "NONE";
+	ActionId m_id = EngineAction::None;
+	ActionType m_type = ActionType::None;
 	Vec2f m_mousePos = { 0, 0 };
 	float m_mouseScrollDelta = 0.0f;
 
 	Action() = default;
-	Action(const std::string& name, const std::string& type)
-		: m_name(name), m_type(type) { }
-	Action(const std::string& name, const std::string& type, const Vec2f& mousePos)
-		: m_name(name), m_type(type), m_mousePos(mousePos) {}
-	Action(const std::string& name, const std::string& type, float msd)
-		: m_name(name), m_type(type), m_mouseScrollDelta(msd) {
+	Action(ActionId id, ActionType type)
+		: m_id(id), m_type(type) { }
+	Action(ActionId id, ActionType type, const Vec2f& mousePos)
+		: m_id(id), m_type(type), m_mousePos(mousePos) {}
+	Action(ActionId id, ActionType type, float msd)
+		: m_id(id), m_type(type), m_mouseScrollDelta(msd) {
 	}
-};
\ No newline at end of file
+};
@@ -1,74 +1,80 @@
 #pragma once
 
 #include "Vec2.hpp"
+#include "AssetHandle.hpp"
 
 #include <vector>
 #include <SFML/Graphics.hpp>
 #include <cmath>
+#include <algorithm>
 
-class Animation
+// shared, immutable description of an animation: which texture its frames are on, how
+// they are laid out and how fast they play; entities only refer to one by handle, with
+// their own playback state in CAnimation
+class AnimationClip
 {
 public:
-	sf::Texture m_texture;
-	sf::Sprite m_sprite = sf::Sprite(m_texture);
+	const sf::Texture* m_texture = nullptr; // the atlas page once the atlas is built
 	size_t m_startFrame = 1;
 	size_t m_frameCount = 1; // total number of frames of animation
-	size_t m_currentFrame = 0; // the current frame of animation being played
 	size_t m_speed = 0; // the speed or duration to play this animation
 	Vec2f m_size = { 1, 1 }; // size of the animation frame
 	std::string m_name = "none";
 	size_t m_rows = 1;
 	size_t m_cols = 1;
+	sf::Vector2i m_atlasOffset = { 0, 0 }; // top-left of the source image on its atlas page
+	AnimationHandle m_handle; // set when Assets registers it
 
-	Animation() = default;
-	Animation(const std::string& name, const sf::Texture& t)
-		: Animation(name, t, 1, 1, 1, 1, 0) { }
-	Animation(const std::string& name, const sf::Texture& t,
+	AnimationClip() = default;
+	AnimationClip(const std::string& name, const sf::Texture& t)
+		: AnimationClip(name, t, t.getSize(), 1, 1, 1, 1, 0) { }
+	// sourceSize is the frame sheet's own size, which differs from t's once it is on an atlas page
+	AnimationClip(const std::string& name, const sf::Texture& t, const sf::Vector2u& sourceSize,
 		size_t rows, size_t cols, size_t startFrame, size_t frameCount, size_t speed)
-		: m_name(name), m_sprite(t),
-		m_rows(rows), m_cols(cols),
-		m_startFrame(startFrame), m_frameCount(frameCount),
-		m_currentFrame(0), m_speed(speed)
+		: m_texture(&t), m_startFrame(startFrame), m_frameCount(frameCount), m_speed(speed),
+		m_name(name), m_rows(rows), m_cols(cols)
 	{
-		m_size = Vec2f(t.getSize().x / static_cast<float>(cols),
-			t.getSize().y / static_cast<float>(rows));
-
-		size_t animFrame = m_startFrame; // starting animation frame
-		size_t curRow = animFrame / m_cols;
-		size_t curCol = animFrame % m_cols;
+		m_size = Vec2f(sourceSize.x / static_cast<float>(cols),
+			sourceSize.y / static_cast<float>(rows));
+	}
 
-		m_sprite.setOrigin(m_size / 2.0f);
-		m_sprite.setTextureRect(sf::IntRect(
-			sf::Vector2i(static_cast<int>(curCol * m_size.x),
-				static_cast<int>(curRow * m_size.y)),
-			sf::Vector2i(static_cast<int>(m_size.x),
-				static_cast<int>(m_size.y))
-		));
+	// moves the frames onto an atlas page that holds the original image at offset
+	void setAtlas(const sf::Texture& page, const sf::Vector2i& offset)
+	{
+		m_texture = &page;
+		m_atlasOffset = offset;
 	}
 
-	void update()
+	sf::IntRect frameRect(size_t row, size_t col) const
 	{
-		if (m_speed > 0 && m_frameCount > 0)
-		{
-			// Compute current frame within looped range
-			size_t frameIndex = (m_currentFrame / m_speed) % m_frameCount;
-			size_t animFrame = m_startFrame + frameIndex;
+		return sf::IntRect(
+			sf::Vector2i(static_cast<int>(col * m_size.x), static_cast<int>(row * m_size.y)) + m_atlasOffset,
+			sf::Vector2i(static_cast<int>(m_size.x), static_cast<int>(m_size.y))
+		);
+	}
 
-			size_t curRow = animFrame / m_cols;
-			size_t curCol = animFrame % m_cols;
+	// rect of the frame-th frame of the clip, counted from its start frame
+	sf::IntRect frameRect(size_t frame) const
+	{
+		size_t animFrame = m_startFrame + frame;
+		return frameRect(animFrame / m_cols, animFrame % m_cols);
+	}
 
-			m_sprite.setTextureRect(sf::IntRect(
-				sf::Vector2i(static_cast<int>(curCol * m_size.x), static_cast<int>(curRow * m_size.y)),
-				sf::Vector2i(static_cast<int>(m_size.x), static_cast<int>(m_size.y))
-			));
+	// frame shown elapsed ticks after playback started; nothing is stored per instance, so
+	// any number of entities can play the same clip and only the drawn ones pay for it
+	size_t frameAt(size_t elapsed, bool repeat) const
+	{
+		if (m_speed == 0 || m_frameCount == 0) return 0;
 
-			m_currentFrame++;
-		}
+		size_t step = elapsed / m_speed;
+		return repeat ? step % m_frameCount : std::min(step, m_frameCount - 1);
 	}
 
-
-	bool hasEnded() const
+	// a standalone sprite showing one frame, centred on its position like the actors are
+	sf::Sprite makeSprite(size_t frame) const
 	{
-		return (m_currentFrame >= m_frameCount * m_speed);
+		sf::Sprite sprite(*m_texture, frameRect(frame));
+		sprite.setOrigin(m_size / 2.0f);
+		return sprite;
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sf
+{
+	class Texture;
+	class Font;
+	class Sound;
+	class Music;
+}
+class AnimationClip;
+
+// index of a loaded asset in its registry; resolved from the asset's name once, when a
+// scene loads or binds it, so systems never hash a name per frame
+template <typename T>
+struct AssetHandle
+{
+	static const uint32_t INVALID = UINT32_MAX;
+	uint32_t index = INVALID;
+
+	bool valid() const
+	{
+		return index != INVALID;
+	}
+
+	bool operator==(const AssetHandle& rhs) const
+	{
+		return index == rhs.index;
+	}
+
+	bool operator!=(const AssetHandle& rhs) const
+	{
+		return index != rhs.index;
+	}
+};
+
+// dense table of assets by handle; the assets themselves stay wherever Assets keeps them
+template <typename T>
+class AssetRegistry
+{
+	std::vector<T*> m_items;
+	std::unordered_map<std::string, AssetHandle<T>> m_handles;
+
+public:
+	AssetRegistry() = default;
+
+	// re-adding a name keeps its handle and points it at the new asset
+	AssetHandle<T> add(const std::string& name, T& item)
+	{
+		auto [it, inserted] = m_handles.try_emplace(name, AssetHandle<T>{ uint32_t(m_items.size()) });
+		if (inserted) m_items.push_back(&item);
+		else m_items[it->second.index] = &item;
+		return it->second;
+	}
+
+	AssetHandle<T> find(const std::string& name) const
+	{
+		auto it = m_handles.find(name);
+		return it == m_handles.end() ? AssetHandle<T>() : it->second;
+	}
+
+	T& get(AssetHandle<T> handle) const
+	{
+		assert(handle.index < m_items.size());
+		return *m_items[handle.index];
+	}
+
+	// for binding by name; an unknown name is a missing manifest entry, so rather than hand
+	// out a handle that would index past the table later, it fails here
+	AssetHandle<T> handle(const std::string& name) const
+	{
+		auto handle = find(name);
+		if (!handle.valid()) throw std::out_of_range("Unknown asset: " + name);
+		return handle;
+	}
+
+	T& get(const std::string& name) const
+	{
+		return get(handle(name));
+	}
+
+	size_t size() const
+	{
+		return m_items.size();
+	}
+};
+
+using TextureHandle = AssetHandle<sf::Texture>;
+using AnimationHandle = AssetHandle<AnimationClip>;
+using FontHandle = AssetHandle<sf::Font>;
+using SoundHandle = AssetHandle<sf::Sound>;
+using MusicHandle = AssetHandle<sf::Music>;
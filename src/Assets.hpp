@@ -1,151 +1,687 @@
 #pragma once
 
 #include "Animation.hpp"
+#include "TextureAtlas.hpp"
+#include "MappedFile.hpp"
+#include "AssetHandle.hpp"
+#include "WorkerPool.hpp"
 #include <fstream>
 #include <iostream>
 #include <cassert>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
 #include <SFML/Audio.hpp>
 
+enum class AssetType { Texture, Animation, Font, Sound, Music, Unknown };
+
+// one line of the asset manifest, plus whatever a worker decoded for it
+struct ManifestEntry
+{
+	AssetType type = AssetType::Unknown;
+	std::string name;
+	std::string path; // source texture for animations
+	size_t rows = 0, cols = 0, start = 0, frames = 0, speed = 0;
+
+	sf::Image image;
+	std::vector<std::int16_t> samples;
+	unsigned int channelCount = 0;
+	unsigned int sampleRate = 0;
+	std::vector<sf::SoundChannel> channelMap;
+	std::vector<char> bytes;
+	bool decoded = false;
+	float decodeMs = 0; // on a worker
+	float finishMs = 0; // on the main thread
+};
+
+// fixed part of an asset bundle index record; the name, the path and the sound channel
+// map follow it, and dataOffset points into the data section after the index
+struct BundleRecord
+{
+	uint32_t type = 0;
+	uint32_t rows = 0, cols = 0, start = 0, frames = 0, speed = 0;
+	uint32_t width = 0, height = 0; // RGBA pixels for textures
+	uint32_t channelCount = 0, sampleRate = 0; // 16-bit samples for sounds
+	uint32_t nameSize = 0, pathSize = 0, channelMapSize = 0;
+	uint64_t dataOffset = 0, dataSize = 0;
+	int64_t sourceTime = 0; // write time and size of the packed source file, so editing it
+	uint64_t sourceSize = 0; // makes the bundle stale even if the manifest is untouched
+};
+
+struct BundleHeader
+{
+	char magic[4] = { 'I', 'S', 'O', 'B' };
+	uint32_t version = 2;
+	uint32_t numEntries = 0;
+	uint32_t indexSize = 0; // the data section starts right after the index
+};
+
 class Assets
 {
 public:
 	std::unordered_map<std::string, sf::Texture> m_textureMap;
-	std::unordered_map<std::string, Animation> m_animationMap;
+	std::unordered_map<std::string, AnimationClip> m_animationMap;
 	std::unordered_map<std::string, sf::Font> m_fontMap;
+	std::unordered_map<std::string, std::vector<char>> m_fontData; // fonts read from memory need it kept
 	std::unordered_map<std::string, sf::SoundBuffer> m_soundBufferMap;
 	std::unordered_map<std::string, sf::Sound> m_soundMap;
 	std::unordered_map<std::string, sf::Music> m_musicMap;
+	std::unordered_map<std::string, sf::Image> m_imageMap; // decoded textures, kept until the atlas is built
+	std::unordered_map<std::string, TextureAtlas::Region> m_atlasRegions;
+	std::vector<sf::Texture> m_atlasPages;
+	std::unordered_map<std::string, std::string> m_textureNames; // animation -> source texture
+	MappedFile m_bundle; // fonts are opened straight from the mapping, so it stays open
+	AssetRegistry<sf::Texture> m_textures;
+	AssetRegistry<AnimationClip> m_animations;
+	AssetRegistry<sf::Font> m_fonts;
+	AssetRegistry<sf::Sound> m_sounds;
+	AssetRegistry<sf::Music> m_musics;
+
+	// map entries never move, so the registries can point straight at them
+	sf::Texture& textureSlot(const std::string& textureName)
+	{
+		auto& texture = m_textureMap[textureName];
+		m_textures.add(textureName, texture);
+		return texture;
+	}
 
-	void addTexture(const std::string& textureName, const std::string& path,
-		bool smooth = false)
+	sf::Font& fontSlot(const std::string& fontName)
 	{
-		m_textureMap[textureName] = sf::Texture();
+		auto& font = m_fontMap[fontName];
+		m_fonts.add(fontName, font);
+		return font;
+	}
 
-		if (!m_textureMap[textureName].loadFromFile(path))
+	sf::Sound& soundSlot(const std::string& soundName)
+	{
+		auto it = m_soundMap.emplace(soundName, sf::Sound(m_soundBufferMap[soundName])).first;
+		m_sounds.add(soundName, it->second);
+		return it->second;
+	}
+
+	// only the decoded image is kept; it reaches the GPU once, on its atlas page, and the
+	// handle is pointed at that page when the atlas is built
+	void addTexture(const std::string& textureName, sf::Image&& image)
+	{
+		textureSlot(textureName);
+		m_imageMap[textureName] = std::move(image);
+	}
+
+	sf::Vector2u sourceSize(const std::string& textureName) const
+	{
+		auto image = m_imageMap.find(textureName);
+		if (image != m_imageMap.end()) return image->second.getSize();
+		auto region = m_atlasRegions.find(textureName);
+		if (region != m_atlasRegions.end()) return sf::Vector2u(region->second.rect.size);
+		return sf::Vector2u();
+	}
+
+	// packs every loaded texture into as few pages as possible and points the animations
+	// at them, so sprites from different source images can share a draw call
+	void buildAtlas()
+	{
+		std::vector<std::string> names;
+		std::vector<sf::Vector2u> sizes;
+		for (auto& [name, image] : m_imageMap)
 		{
-			std::cerr << "Could not load texture from file: " << path << std::endl;
-			return;
+			names.push_back(name);
+			sizes.push_back(image.getSize());
 		}
 
-		m_textureMap[textureName].setSmooth(smooth);
+		TextureAtlas atlas(int(std::min(2048u, sf::Texture::getMaximumSize())), 1);
+		auto regions = atlas.pack(sizes);
+
+		std::vector<sf::Image> pages;
+		for (size_t p = 0; p < atlas.m_pages.size(); ++p)
+		{
+			pages.emplace_back(atlas.pageSize(p), sf::Color::Transparent);
+		}
+		for (size_t i = 0; i < names.size(); ++i)
+		{
+			auto& region = regions[i];
+			if (!pages[region.page].copy(m_imageMap[names[i]], sf::Vector2u(region.rect.position)))
+			{
+				std::cerr << "Could not copy texture into atlas: " << names[i] << std::endl;
+			}
+			m_atlasRegions[names[i]] = region;
+		}
+
+		m_atlasPages.resize(pages.size());
+		for (size_t p = 0; p < pages.size(); ++p)
+		{
+			if (!m_atlasPages[p].loadFromImage(pages[p]))
+			{
+				std::cerr << "Could not create atlas page " << p << std::endl;
+			}
+		}
+
+		// a texture is served from its page from now on; the page never moves, since it
+		// is only resized above
+		for (auto& name : names)
+		{
+			m_textures.add(name, m_atlasPages[m_atlasRegions.at(name).page]);
+		}
+
+		for (auto& [name, animation] : m_animationMap)
+		{
+			auto it = m_textureNames.find(name);
+			if (it == m_textureNames.end() || !m_atlasRegions.contains(it->second)) continue;
+
+			auto& region = m_atlasRegions.at(it->second);
+			animation.setAtlas(m_atlasPages[region.page], region.rect.position);
+		}
+
+		m_imageMap.clear();
 	}
 
 	void addAnimation(const std::string& animationName, const std::string& textureName,
 		size_t rows, size_t cols, size_t startFrame, size_t frameCount, size_t speed)
 	{
-		m_animationMap[animationName] = Animation(animationName, m_textureMap[textureName],
-			rows, cols, startFrame, frameCount, speed);
+		auto [it, inserted] = m_animationMap.insert_or_assign(animationName, AnimationClip(animationName,
+			textureSlot(textureName), sourceSize(textureName), rows, cols, startFrame, frameCount, speed));
+		it->second.m_handle = m_animations.add(animationName, it->second);
+		m_textureNames[animationName] = textureName;
 	}
 
-	void addFont(const std::string& fontName, const std::string& path)
+	void addFont(const std::string& fontName, std::vector<char>&& bytes)
 	{
-		m_fontMap[fontName] = sf::Font();
-		if (!m_fontMap[fontName].openFromFile(path))
+		auto& data = m_fontData[fontName] = std::move(bytes);
+		if (!fontSlot(fontName).openFromMemory(data.data(), data.size()))
 		{
-			std::cerr << "Could not load font file: " << path << std::endl;
+			std::cerr << "Could not load font: " << fontName << std::endl;
 		}
 	}
 
-	void addSound(const std::string& soundName, const std::string& path)
+	void addSound(const std::string& soundName, const std::int16_t* samples, uint64_t sampleCount,
+		unsigned int channelCount, unsigned int sampleRate, const std::vector<sf::SoundChannel>& channelMap)
 	{
-		m_soundBufferMap[soundName] = sf::SoundBuffer();
-		if (!m_soundBufferMap[soundName].loadFromFile(path))
+		auto& buffer = m_soundBufferMap[soundName];
+		if (!buffer.loadFromSamples(samples, sampleCount, channelCount, sampleRate, channelMap))
 		{
-			std::cerr << "Could not load sound file: " << path << std::endl;
+			std::cerr << "Could not load sound: " << soundName << std::endl;
 		}
-		m_soundMap.emplace(soundName, sf::Sound(m_soundBufferMap[soundName]));
+		soundSlot(soundName);
 	}
 
 	void addMusic(const std::string& musicName, const std::string& path)
 	{
-		m_musicMap[musicName] = sf::Music();
-		if (!m_musicMap[musicName].openFromFile(path))
+		// music is streamed while it plays, so opening it only reads the header
+		auto& music = m_musicMap[musicName];
+		m_musics.add(musicName, music);
+		if (!music.openFromFile(path))
 		{
 			std::cerr << "Could not load music file: " << path << std::endl;
 		}
 	}
 	
 	Assets() = default;
-	void loadFromFile(const std::string& path)
+
+	static std::vector<ManifestEntry> parseManifest(const std::string& path)
 	{
+		std::vector<ManifestEntry> entries;
 		auto file = std::ifstream(path);
 		std::string str;
-		while (file.good())
+		while (file >> str)
 		{
-			file >> str;
-			if (str == "Texture")
+			ManifestEntry entry;
+			if (str == "Texture") entry.type = AssetType::Texture;
+			else if (str == "Animation") entry.type = AssetType::Animation;
+			else if (str == "Font") entry.type = AssetType::Font;
+			else if (str == "Sound") entry.type = AssetType::Sound;
+			else if (str == "Music") entry.type = AssetType::Music;
+			else
 			{
-				std::string name, path;
-				file >> name >> path;
-				addTexture(name, path);
+				std::cerr << "Unknown Asset Type: " << str << std::endl;
+				continue;
 			}
-			else if (str == "Animation")
+
+			file >> entry.name >> entry.path;
+			if (entry.type == AssetType::Animation)
 			{
-				std::string name, texture;
-				size_t rows, cols;
-				size_t start, frames, speed;
-				file >> name >> texture >> rows >> cols >> start >> frames >> speed;
-				addAnimation(name, texture, rows, cols, start, frames, speed);
+				file >> entry.rows >> entry.cols >> entry.start >> entry.frames >> entry.speed;
 			}
-			else if (str == "Font")
+			entries.push_back(std::move(entry));
+		}
+		return entries;
+	}
+
+	// file reads and image/audio decoding only; nothing here needs the main thread
+	static void decodeEntry(ManifestEntry& entry)
+	{
+		sf::Clock clock;
+		switch (entry.type)
+		{
+		case AssetType::Texture:
+			entry.decoded = entry.image.loadFromFile(entry.path);
+			break;
+		case AssetType::Sound:
+		{
+			sf::InputSoundFile file;
+			if (!file.openFromFile(entry.path)) break;
+			entry.samples.resize(size_t(file.getSampleCount()));
+			entry.samples.resize(size_t(file.read(entry.samples.data(), entry.samples.size())));
+			entry.channelCount = file.getChannelCount();
+			entry.sampleRate = file.getSampleRate();
+			entry.channelMap = file.getChannelMap();
+			entry.decoded = true;
+			break;
+		}
+		case AssetType::Font:
+		{
+			std::ifstream file(entry.path, std::ios::binary);
+			entry.bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			entry.decoded = !entry.bytes.empty();
+			break;
+		}
+		default:
+			entry.decoded = true;
+			break;
+		}
+		entry.decodeMs = clock.getElapsedTime().asMicroseconds() / 1000.0f;
+	}
+
+	static void decodeEntries(std::vector<ManifestEntry>& entries)
+	{
+		// every entry decodes into its own buffers, so the jobs are independent
+		WorkerPool::shared().parallelFor(entries.size(), [&](size_t j) { decodeEntry(entries[j]); });
+	}
+
+	// texture creation and everything that refers to other assets, in manifest order
+	void finishEntry(ManifestEntry& entry)
+	{
+		sf::Clock clock;
+		if (!entry.decoded)
+		{
+			std::cerr << "Could not load asset file: " << entry.path << std::endl;
+			if (entry.type == AssetType::Texture) textureSlot(entry.name);
+			if (entry.type == AssetType::Font) fontSlot(entry.name);
+			if (entry.type == AssetType::Sound) soundSlot(entry.name);
+			return;
+		}
+
+		switch (entry.type)
+		{
+		case AssetType::Texture: addTexture(entry.name, std::move(entry.image)); break;
+		case AssetType::Animation:
+			addAnimation(entry.name, entry.path, entry.rows, entry.cols, entry.start, entry.frames, entry.speed);
+			break;
+		case AssetType::Font: addFont(entry.name, std::move(entry.bytes)); break;
+		case AssetType::Sound:
+			addSound(entry.name, entry.samples.data(), entry.samples.size(),
+				entry.channelCount, entry.sampleRate, entry.channelMap);
+			break;
+		case AssetType::Music: addMusic(entry.name, entry.path); break;
+		default: break;
+		}
+		entry.finishMs = clock.getElapsedTime().asMicroseconds() / 1000.0f;
+	}
+
+	static void reportLoadTimes(std::vector<ManifestEntry>& entries, float totalMs)
+	{
+		std::sort(entries.begin(), entries.end(), [](const ManifestEntry& a, const ManifestEntry& b)
+		{
+			return a.decodeMs + a.finishMs > b.decodeMs + b.finishMs;
+		});
+		for (auto& entry : entries)
+		{
+			if (entry.type == AssetType::Animation) continue;
+			std::cout << "[assets] " << entry.name << " (" << entry.path << "): "
+				<< entry.decodeMs << " ms decode, " << entry.finishMs << " ms finish" << std::endl;
+		}
+		std::cout << "[assets] " << entries.size() << " assets loaded in " << totalMs << " ms" << std::endl;
+	}
+
+	void loadFromFile(const std::string& path)
+	{
+		sf::Clock clock;
+		auto entries = parseManifest(path);
+		decodeEntries(entries);
+		for (auto& entry : entries)
+		{
+			finishEntry(entry);
+		}
+		buildAtlas();
+		reportLoadTimes(entries, clock.getElapsedTime().asMicroseconds() / 1000.0f);
+	}
+
+	// bundle next to a manifest, used instead of it once it is at least as new
+	static std::string bundlePath(const std::string& manifestPath)
+	{
+		return std::filesystem::path(manifestPath).replace_extension(".bundle").string();
+	}
+
+	// texture, sound and font payloads are copies of their source file; the others are not
+	static bool isPacked(AssetType type)
+	{
+		return type == AssetType::Texture || type == AssetType::Sound || type == AssetType::Font;
+	}
+
+	static bool sourceStamp(const std::string& path, int64_t& time, uint64_t& size)
+	{
+		std::error_code error;
+		auto writeTime = std::filesystem::last_write_time(path, error);
+		if (error) return false;
+		size = std::filesystem::file_size(path, error);
+		if (error) return false;
+		time = int64_t(writeTime.time_since_epoch().count());
+		return true;
+	}
+
+	void load(const std::string& manifestPath)
+	{
+		std::error_code error;
+		auto bundle = bundlePath(manifestPath);
+		bool current = std::filesystem::exists(bundle, error) &&
+			std::filesystem::last_write_time(bundle, error) >= std::filesystem::last_write_time(manifestPath, error);
+		if (current && loadFromBundle(bundle)) return;
+
+		loadFromFile(manifestPath);
+	}
+
+	// offline step: decodes everything in the manifest once and writes it out as a single
+	// bundle of raw pixels, samples and font files behind a binary index
+	static bool writeBundle(const std::string& manifestPath, const std::string& bundlePath)
+	{
+		auto entries = parseManifest(manifestPath);
+		decodeEntries(entries);
+
+		std::vector<char> index, data;
+		auto append = [](std::vector<char>& out, const void* bytes, size_t size)
+		{
+			auto* begin = static_cast<const char*>(bytes);
+			out.insert(out.end(), begin, begin + size);
+		};
+
+		for (auto& entry : entries)
+		{
+			if (!entry.decoded)
 			{
-				std::string name, path;
-				file >> name >> path;
-				addFont(name, path);
+				std::cerr << "Could not load asset file: " << entry.path << std::endl;
+				return false;
 			}
-			else if (str == "Sound")
+
+			BundleRecord record;
+			record.type = uint32_t(entry.type);
+			record.rows = uint32_t(entry.rows);
+			record.cols = uint32_t(entry.cols);
+			record.start = uint32_t(entry.start);
+			record.frames = uint32_t(entry.frames);
+			record.speed = uint32_t(entry.speed);
+			record.nameSize = uint32_t(entry.name.size());
+			record.pathSize = uint32_t(entry.path.size());
+			if (isPacked(entry.type)) sourceStamp(entry.path, record.sourceTime, record.sourceSize);
+
+			// payloads are 8-byte aligned so samples can be used in place
+			data.resize((data.size() + 7) & ~size_t(7));
+			record.dataOffset = data.size();
+			if (entry.type == AssetType::Texture)
 			{
-				std::string name, path;
-				file >> name >> path;
-				addSound(name, path);
+				record.width = entry.image.getSize().x;
+				record.height = entry.image.getSize().y;
+				append(data, entry.image.getPixelsPtr(), size_t(record.width) * record.height * 4);
 			}
-			else if (str == "Music")
+			else if (entry.type == AssetType::Sound)
 			{
-				std::string name, path;
-				file >> name >> path;
-				addMusic(name, path);
+				record.channelCount = entry.channelCount;
+				record.sampleRate = entry.sampleRate;
+				record.channelMapSize = uint32_t(entry.channelMap.size());
+				append(data, entry.samples.data(), entry.samples.size() * sizeof(std::int16_t));
 			}
-			else
+			else if (entry.type == AssetType::Font)
 			{
-				std::cerr << "Unknown Asset Type: " << str << std::endl;
+				append(data, entry.bytes.data(), entry.bytes.size());
+			}
+			record.dataSize = data.size() - record.dataOffset;
+
+			append(index, &record, sizeof(record));
+			append(index, entry.name.data(), entry.name.size());
+			append(index, entry.path.data(), entry.path.size());
+			for (auto channel : entry.channelMap)
+			{
+				uint8_t value = uint8_t(channel);
+				append(index, &value, 1);
+			}
+		}
+		index.resize((index.size() + 7) & ~size_t(7));
+
+		BundleHeader header;
+		header.numEntries = uint32_t(entries.size());
+		header.indexSize = uint32_t(index.size());
+
+		std::ofstream file(bundlePath, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(index.data(), std::streamsize(index.size()));
+		file.write(data.data(), std::streamsize(data.size()));
+		if (!file)
+		{
+			std::cerr << "Could not write asset bundle: " << bundlePath << std::endl;
+			return false;
+		}
+
+		std::cout << "[assets] packed " << entries.size() << " assets into " << bundlePath << ", "
+			<< (sizeof(header) + index.size() + data.size()) / 1024 << " KB" << std::endl;
+		return true;
+	}
+
+	// creates every resource straight from the mapped bundle; nothing is decoded and the
+	// only reads are the pages each resource touches
+	bool loadFromBundle(const std::string& path)
+	{
+		sf::Clock clock;
+		if (!m_bundle.open(path)) return false;
+
+		auto reject = [&](const std::string& reason)
+		{
+			std::cerr << "Asset bundle " << reason << ": " << path << std::endl;
+			m_bundle.close();
+			return false;
+		};
+
+		const char* bytes = m_bundle.data();
+		size_t size = m_bundle.size();
+		BundleHeader header, expected;
+		if (size < sizeof(header)) return reject("is truncated");
+		std::memcpy(&header, bytes, sizeof(header));
+		if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+			header.version != expected.version)
+		{
+			return reject("is out of date");
+		}
+		if (size_t(header.indexSize) > size - sizeof(header) ||
+			uint64_t(header.numEntries) * sizeof(BundleRecord) > header.indexSize)
+		{
+			return reject("is truncated");
+		}
+
+		// the whole index is checked before anything is created, so a bad bundle leaves no
+		// assets behind and the loose files are loaded instead
+		struct BundleEntry
+		{
+			BundleRecord record;
+			std::string name;
+			std::string path;
+			std::vector<sf::SoundChannel> channelMap;
+		};
+		std::vector<BundleEntry> entries(header.numEntries);
+
+		const char* cursor = bytes + sizeof(header);
+		const char* indexEnd = cursor + header.indexSize;
+		const char* dataStart = indexEnd;
+		uint64_t dataBytes = uint64_t(bytes + size - dataStart);
+		for (auto& entry : entries)
+		{
+			auto& record = entry.record;
+			if (size_t(indexEnd - cursor) < sizeof(record)) return reject("index is truncated");
+			std::memcpy(&record, cursor, sizeof(record));
+			cursor += sizeof(record);
+
+			uint64_t strings = uint64_t(record.nameSize) + record.pathSize + record.channelMapSize;
+			if (strings > uint64_t(indexEnd - cursor)) return reject("index is truncated");
+			entry.name.assign(cursor, record.nameSize);
+			cursor += record.nameSize;
+			entry.path.assign(cursor, record.pathSize);
+			cursor += record.pathSize;
+			for (uint32_t c = 0; c < record.channelMapSize; ++c)
+			{
+				entry.channelMap.push_back(sf::SoundChannel(uint8_t(*cursor++)));
+			}
+
+			if (record.type >= uint32_t(AssetType::Unknown)) return reject("has an unknown asset type");
+			auto type = AssetType(record.type);
+			if (record.dataOffset > dataBytes || record.dataSize > dataBytes - record.dataOffset)
+			{
+				return reject("payload is out of range");
+			}
+			if (type == AssetType::Texture && record.dataSize != uint64_t(record.width) * record.height * 4)
+			{
+				return reject("texture size does not match its pixels");
+			}
+			if (type == AssetType::Sound && (record.channelCount == 0 || record.dataSize % sizeof(std::int16_t) != 0))
+			{
+				return reject("sound payload is malformed");
+			}
+
+			// a source that is still around but differs from what was packed wins; a bundle
+			// shipped without its sources is used as is
+			int64_t sourceTime = 0;
+			uint64_t sourceSize = 0;
+			if (isPacked(type) && sourceStamp(entry.path, sourceTime, sourceSize) &&
+				(sourceTime != record.sourceTime || sourceSize != record.sourceSize))
+			{
+				return reject("is older than " + entry.path);
 			}
 		}
-		file.close();
+
+		for (auto& entry : entries)
+		{
+			auto& record = entry.record;
+			const char* payload = dataStart + record.dataOffset;
+			switch (AssetType(record.type))
+			{
+			case AssetType::Texture:
+				addTexture(entry.name, sf::Image({ record.width, record.height },
+					reinterpret_cast<const std::uint8_t*>(payload)));
+				break;
+			case AssetType::Animation:
+				addAnimation(entry.name, entry.path, record.rows, record.cols, record.start, record.frames, record.speed);
+				break;
+			case AssetType::Font:
+				if (!fontSlot(entry.name).openFromMemory(payload, size_t(record.dataSize)))
+				{
+					std::cerr << "Could not load font: " << entry.name << std::endl;
+				}
+				break;
+			case AssetType::Sound:
+				addSound(entry.name, reinterpret_cast<const std::int16_t*>(payload), record.dataSize / sizeof(std::int16_t),
+					record.channelCount, record.sampleRate, entry.channelMap);
+				break;
+			case AssetType::Music:
+				addMusic(entry.name, entry.path);
+				break;
+			default:
+				break;
+			}
+		}
+		buildAtlas();
+
+		std::cout << "[assets] " << header.numEntries << " assets loaded from " << path << " in "
+			<< clock.getElapsedTime().asMicroseconds() / 1000.0f << " ms" << std::endl;
+		return true;
+	}
+
+	// name lookups are for load and bind time, and throw for names the manifest lacks;
+	// per-frame code holds on to the handles
+	TextureHandle textureHandle(const std::string& textureName) const
+	{
+		return m_textures.handle(textureName);
+	}
+
+	AnimationHandle animationHandle(const std::string& animationName) const
+	{
+		return m_animations.handle(animationName);
+	}
+
+	FontHandle fontHandle(const std::string& fontName) const
+	{
+		return m_fonts.handle(fontName);
+	}
+
+	SoundHandle soundHandle(const std::string& soundName) const
+	{
+		return m_sounds.handle(soundName);
+	}
+
+	MusicHandle musicHandle(const std::string& musicName) const
+	{
+		return m_musics.handle(musicName);
+	}
+
+	// the atlas page a texture was packed onto; its pixels are at getAtlasRegion(name).rect
+	const sf::Texture& getTexture(TextureHandle handle) const
+	{
+		return m_textures.get(handle);
 	}
 
 	const sf::Texture& getTexture(const std::string& textureName) const
 	{
-		assert(m_textureMap.find(textureName) != m_textureMap.end());
-		return m_textureMap.at(textureName);
+		return m_textures.get(textureName);
+	}
+
+	// where a texture ended up in the atlas; draw with getAtlasPage(region.page). a texture
+	// that is unknown or failed to load never got a region
+	const TextureAtlas::Region& getAtlasRegion(const std::string& textureName) const
+	{
+		auto it = m_atlasRegions.find(textureName);
+		if (it == m_atlasRegions.end()) throw std::runtime_error("Texture is not in the atlas: " + textureName);
+		return it->second;
+	}
+
+	const sf::Texture& getAtlasPage(size_t page) const
+	{
+		assert(page < m_atlasPages.size());
+		return m_atlasPages[page];
+	}
+
+	const AnimationClip& getAnimation(AnimationHandle handle) const
+	{
+		return m_animations.get(handle);
 	}
 
-	sf::Texture& getTexture(const std::string& textureName)
+	const AnimationClip& getAnimation(const std::string& animationName) const
 	{
-		assert(m_textureMap.find(textureName) != m_textureMap.end());
-		return m_textureMap.at(textureName);
+		return m_animations.get(animationName);
 	}
 
-	const Animation& getAnimation(const std::string& animationName) const
+	const sf::Font& getFont(FontHandle handle) const
 	{
-		assert(m_animationMap.find(animationName) != m_animationMap.end());
-		return m_animationMap.at(animationName);
+		return m_fonts.get(handle);
 	}
 
 	const sf::Font& getFont(const std::string& fontName) const
 	{
-		assert(m_fontMap.find(fontName) != m_fontMap.end());
-		return m_fontMap.at(fontName);
+		return m_fonts.get(fontName);
+	}
+
+	sf::Sound& getSound(SoundHandle handle)
+	{
+		return m_sounds.get(handle);
 	}
 
 	sf::Sound& getSound(const std::string& soundName)
 	{
-		assert(m_soundMap.find(soundName) != m_soundMap.end());
-		return m_soundMap.at(soundName);
+		return m_sounds.get(soundName);
+	}
+
+	sf::Music& getMusic(MusicHandle handle)
+	{
+		return m_musics.get(handle);
 	}
 
 	sf::Music& getMusic(const std::string& musicName)
 	{
-		assert(m_musicMap.find(musicName) != m_musicMap.end());
-		return m_musicMap.at(musicName);
+		return m_musics.get(musicName);
 	}
 };
\ No newline at end of file
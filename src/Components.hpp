@@ -34,34 +34,112 @@ public:
 	CGridPosition(const Grid3D& p): pos(p) {}
 };
 
-class CChunkTiles
+enum class TileMaterial : uint8_t { Water, Sand, Grass, Snow, Count };
+
+// position is local to the owning chunk, so a tile packs into four bytes
+class Tile
 {
 public:
-	std::vector<Entity> tiles;
-	bool changed = false;
+	uint8_t x = 0;
+	uint8_t y = 0;
+	uint8_t z = 0;
+	TileMaterial material = TileMaterial::Grass;
+
+	Tile() = default;
+	Tile(int ix, int iy, int iz, TileMaterial m)
+		: x(uint8_t(ix)), y(uint8_t(iy)), z(uint8_t(iz)), material(m) {}
+
+	// depth within a layer, larger is farther from the viewer
+	int depth() const
+	{
+		return x + y;
+	}
+
+	// draw order is layer by layer from the bottom (z descending), then depth descending,
+	// ties broken by x descending
+	bool drawsBefore(const Tile& other) const
+	{
+		return std::make_tuple(other.z, other.depth(), other.x) < std::make_tuple(z, depth(), x);
+	}
+
+	bool samePos(const Tile& other) const
+	{
+		return x == other.x && y == other.y && z == other.z;
+	}
+};
 
-	CChunkTiles() = default;
-	CChunkTiles(const std::vector<Entity>& t) : tiles(t) {}
+// offsets into a tile list or mesh kept in Tile::drawsBefore order, one bucket per
+// (z, depth) pair, so layer cuts and actor insertion points are plain lookups
+class TileBuckets
+{
+public:
+	std::vector<uint32_t> starts; // first element of each bucket, plus the end
+	int bottom = 0;				  // z of the first layer
+	int numLayers = 0;
+	int maxDepth = 0;			  // depth of the first bucket in each layer
+	int numDepths = 0;
+
+	void reset(const Grid3D& minPos, const Grid3D& size)
+	{
+		bottom = int(minPos.z + size.z) - 1;
+		numLayers = int(size.z);
+		numDepths = int(size.x + size.y) - 1;
+		maxDepth = int(minPos.x + minPos.y) + numDepths - 1;
+		starts.assign(size_t(numLayers) * numDepths + 1, 0);
+	}
+
+	size_t numBuckets() const
+	{
+		return starts.size() - 1;
+	}
+
+	size_t bucket(int z, int depth) const
+	{
+		return size_t(bottom - z) * numDepths + size_t(maxDepth - depth);
+	}
+
+	size_t bucket(const Tile& tile) const
+	{
+		return bucket(tile.z, tile.depth());
+	}
+
+	// end of the layers at or below z
+	size_t layerEnd(int z) const
+	{
+		int layers = std::clamp(bottom - z + 1, 0, numLayers);
+		return starts[size_t(layers) * numDepths];
+	}
+
+	// end of everything drawn before an actor standing at pos
+	size_t split(const Grid3D& pos) const
+	{
+		int layers = std::clamp(int(std::ceil(bottom - pos.z)), 0, numLayers);
+		size_t b = size_t(layers) * numDepths;
+		if (layers < numLayers && float(bottom - layers) == pos.z)
+		{
+			b += std::clamp(int(std::ceil(maxDepth - pos.x - pos.y)), 0, numDepths);
+		}
+		return starts[b];
+	}
 };
 
-class CTileRenderInfo
+class CChunkTiles
 {
 public:
-	sf::Vector2f position;
-	sf::IntRect textureRect;
+	std::vector<Tile> tiles; // kept in draw order
+	TileBuckets buckets;	 // in tiles, local to the chunk
 
-	CTileRenderInfo() = default;
-	CTileRenderInfo(const sf::Vector2f& p, const sf::IntRect& r)
-		: position(p), textureRect(r) { }
+	CChunkTiles() = default;
+	CChunkTiles(const std::vector<Tile>& t) : tiles(t) {}
 };
 
-class CVertexArray
+class CScreenBounds
 {
 public:
-	sf::VertexArray va;
+	sf::FloatRect rect; // isometric screen-space extent, for view culling
 
-	CVertexArray() = default;
-	CVertexArray(const sf::VertexArray& iva) : va(iva) {}
+	CScreenBounds() = default;
+	CScreenBounds(const sf::FloatRect& r) : rect(r) {}
 };
 
 class CInput
@@ -107,15 +185,17 @@ public:
 		: size(s), halfSize(s / 2) { }
 };
 
+// per-entity playback of a shared clip, a few bytes however many actors play the clip
 class CAnimation
 {
 public:
-	Animation animation;
+	AnimationHandle clip;
+	size_t startTick = 0; // scene frame the clip started playing on, as wide as the counter
 	bool repeat = false;
 
 	CAnimation() = default;
-	CAnimation(const Animation& a, bool r)
-		: animation(a), repeat(r) {}
+	CAnimation(AnimationHandle c, size_t start, bool r)
+		: clip(c), startTick(start), repeat(r) {}
 };
 
 class CState
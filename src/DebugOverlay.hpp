@@ -0,0 +1,110 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// on-screen stats readout that keeps its sf::Text objects between frames and only
+// re-lays out a line when its formatted contents change; formatting goes through fixed
+// buffers and frame times through a ring, so a steady frame allocates nothing
+class DebugOverlay
+{
+public:
+	static const size_t MAX_LINES = 8;
+	static const size_t LINE_LENGTH = 192;
+	static const size_t FRAME_HISTORY = 256;
+	static const size_t PERCENTILE_INTERVAL = 30; // frames between percentile refreshes
+
+	struct Percentiles
+	{
+		float p50 = 0;
+		float p95 = 0;
+		float p99 = 0;
+		float max = 0;
+	};
+
+private:
+	std::vector<sf::Text> m_texts;
+	std::array<std::array<char, LINE_LENGTH>, MAX_LINES> m_lines = {};
+	std::array<char, LINE_LENGTH> m_scratch = {};
+	std::array<float, FRAME_HISTORY> m_frameTimes = {};
+	std::array<float, FRAME_HISTORY> m_sorted = {};
+	size_t m_numFrames = 0;
+	Percentiles m_percentiles;
+	sf::Clock m_frameClock;
+	size_t m_layouts = 0;
+
+public:
+	bool m_visible = true;
+
+	DebugOverlay() = default;
+
+	void init(const sf::Font& font, unsigned int characterSize, float lineHeight)
+	{
+		m_texts.clear();
+		m_texts.reserve(MAX_LINES);
+		for (size_t i = 0; i < MAX_LINES; ++i)
+		{
+			m_texts.emplace_back(font, "", characterSize);
+			m_texts.back().setPosition(sf::Vector2f(0, lineHeight * i));
+			m_lines[i][0] = '\0';
+		}
+		m_numFrames = 0;
+		m_frameClock.restart();
+	}
+
+	// call once per rendered frame
+	void recordFrame()
+	{
+		float ms = m_frameClock.restart().asMicroseconds() / 1000.0f;
+		m_frameTimes[m_numFrames % FRAME_HISTORY] = ms;
+		m_numFrames++;
+
+		// percentiles move every frame, so they are refreshed on an interval to keep the
+		// line from being re-laid out constantly
+		if (m_numFrames % PERCENTILE_INTERVAL != 0) return;
+
+		size_t count = std::min(m_numFrames, FRAME_HISTORY);
+		std::copy(m_frameTimes.begin(), m_frameTimes.begin() + count, m_sorted.begin());
+		std::sort(m_sorted.begin(), m_sorted.begin() + count);
+		auto at = [&](float p) { return m_sorted[std::min(count - 1, size_t(p * count))]; };
+		m_percentiles = { at(0.5f), at(0.95f), at(0.99f), m_sorted[count - 1] };
+	}
+
+	const Percentiles& frameTimes() const
+	{
+		return m_percentiles;
+	}
+
+	// number of times any line had to be re-laid out, for checking the overlay itself
+	size_t layouts() const
+	{
+		return m_layouts;
+	}
+
+	template <typename... Args>
+	void setLine(size_t line, const char* format, Args... args)
+	{
+		if (line >= m_texts.size()) return;
+
+		std::snprintf(m_scratch.data(), m_scratch.size(), format, args...);
+		if (std::strcmp(m_scratch.data(), m_lines[line].data()) == 0) return;
+
+		m_lines[line] = m_scratch;
+		m_texts[line].setString(m_lines[line].data());
+		m_layouts++;
+	}
+
+	void draw(sf::RenderTarget& target) const
+	{
+		if (!m_visible) return;
+
+		for (size_t i = 0; i < m_texts.size(); ++i)
+		{
+			if (m_lines[i][0] != '\0') target.draw(m_texts[i]);
+		}
+	}
+};
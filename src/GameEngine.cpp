@@ -5,20 +5,29 @@
 #include "Scene.h"
 
 #include <fstream>
+#include <algorithm>
 #include <iostream>
 
-GameEngine::GameEngine(const std::string& path)
+GameEngine::GameEngine(const std::string& path, std::optional<uint64_t> seed)
 {
-	init(path);
+	init(path, seed);
 }
 
-void GameEngine::init(const std::string& path)
+void GameEngine::init(const std::string& path, std::optional<uint64_t> seed)
 {
-	m_assets.loadFromFile(path);
+	// every random stream splits off this one seed, so passing it back in with --seed
+	// reproduces a run
+	uint64_t rootSeed = seed ? *seed : static_cast<uint64_t>(time(nullptr));
+	std::cout << "Random seed: " << rootSeed << std::endl;
+	m_random = Random(rootSeed);
+
+	m_assets.load(path);
 
 	auto videoMode = sf::VideoMode({ 1920, 1080 });
 	m_window.create(videoMode, "Game Engine", sf::Style::Default);
 	m_window.setFramerateLimit(60);
+	m_windowWidth = m_window.getSize().x;
+	m_windowHeight = m_window.getSize().y;
 
 	/*if (!ImGui::SFML::Init(m_window))
 	{
@@ -44,24 +53,41 @@ sf::RenderWindow& GameEngine::window()
 	return m_window;
 }
 
+sf::Vector2u GameEngine::windowSize() const
+{
+	return sf::Vector2u(m_windowWidth, m_windowHeight);
+}
+
 void GameEngine::run()
 {
 	while (isRunning())
 	{
+		// the scene may only change while no simulation pass is in flight
+		finishSimulation();
+		collectLoadedScenes();
+
 		if (!m_nextScene.empty())
 		{
 			if (!m_currentScene.empty())
+			{
 				currentScene()->onExitScene();
+				if (m_endCurrentScene) m_sceneMap.erase(m_currentScene);
+			}
+			if (m_nextScenePtr) m_sceneMap[m_nextScene] = std::move(m_nextScenePtr);
 
 			m_currentScene = m_nextScene;
 			m_nextScene.clear();
+			m_endCurrentScene = false;
 
 			currentScene()->onEnterScene();
+			m_accumulator = sf::Time::Zero;
+			m_deltaClock.restart();
 		}
 
 		//ImGui::SFML::Update(m_window, m_deltaClock.restart());
 		update();
 	}
+	finishSimulation();
 	//ImGui::SFML::Shutdown();
 	m_window.close();
 	
@@ -69,6 +95,8 @@ void GameEngine::run()
 
 void GameEngine::sUserInput()
 {
+	// bindings are flat tables on the scene, so an event costs an index and no allocation
+	auto scene = currentScene();
 	while (const std::optional event = m_window.pollEvent())
 	{
 		//ImGui::SFML::ProcessEvent(m_window, *event);
@@ -78,78 +106,44 @@ void GameEngine::sUserInput()
 			quit();
 		}
 
+		if (const auto* resized = event->getIf<sf::Event::Resized>())
+		{
+			m_windowWidth = resized->size.x;
+			m_windowHeight = resized->size.y;
+		}
+
 		if (const auto* keyPressed = event->getIf<sf::Event::KeyPressed>())
 		{
-			if (currentScene()->getKeyActionMap().find(keyPressed->scancode) ==
-				currentScene()->getKeyActionMap().end())
-			{
-				continue;
-			}
-			currentScene()->doAction
-			(
-				Action
-				(
-				currentScene()->getKeyActionMap().at(keyPressed->scancode),
-				"START"
-				)
-			);
+			ActionId action = scene->keyAction(keyPressed->scancode);
+			if (action != EngineAction::None) scene->doAction(Action(action, ActionType::Start));
 		}
 
 		if (const auto* keyReleased = event->getIf<sf::Event::KeyReleased>())
 		{
-			if (currentScene()->getKeyActionMap().find(keyReleased->scancode) ==
-				currentScene()->getKeyActionMap().end())
-			{
-				continue;
-			}
-			currentScene()->doAction
-			(
-				Action
-				(
-					currentScene()->getKeyActionMap().at(keyReleased->scancode),
-					"END"
-				)
-			);
+			ActionId action = scene->keyAction(keyReleased->scancode);
+			if (action != EngineAction::None) scene->doAction(Action(action, ActionType::End));
 		}
 
 		if (const auto* mousePressed = event->getIf<sf::Event::MouseButtonPressed>())
 		{
-            if (currentScene()->m_mouseActionMap.find(mousePressed->button) != currentScene()->m_mouseActionMap.end())  
-            {  
-                currentScene()->doAction  
-                (  
-                    Action  
-                    (  
-                        currentScene()->getMouseActionMap().at(mousePressed->button),  
-                        "START", mousePressed->position  
-                    )
-                );
-            }
+			ActionId action = scene->mouseAction(mousePressed->button);
+			if (action != EngineAction::None) scene->doAction(Action(action, ActionType::Start, mousePressed->position));
 		}
 
 		if (const auto* mouseReleased = event->getIf<sf::Event::MouseButtonReleased>())
 		{
-			if (currentScene()->m_mouseActionMap.find(mouseReleased->button) != currentScene()->m_mouseActionMap.end())
-			{
-				currentScene()->doAction
-				(
-					Action
-					(
-						currentScene()->getMouseActionMap().at(mouseReleased->button),
-						"END", mouseReleased->position
-					)
-				);
-			}
+			ActionId action = scene->mouseAction(mouseReleased->button);
+			if (action != EngineAction::None) scene->doAction(Action(action, ActionType::End, mouseReleased->position));
 		}
 
 		if (const auto* mouseMoved = event->getIf<sf::Event::MouseMoved>())
 		{
-			currentScene()->doAction(Action("MOUSE_MOVE", "START", mouseMoved->position));
+			scene->doAction(Action(EngineAction::MouseMove, ActionType::Start, mouseMoved->position));
 		}
 
 		if (const auto* mouseWheelScrolled = event->getIf<sf::Event::MouseWheelScrolled>())
 		{
-			currentScene()->doAction(Action("MOUSE_SCROLL", "START", mouseWheelScrolled->delta));
+			scene->doAction(Action(EngineAction::MouseScroll, ActionType::Start, mouseWheelScrolled->delta));
 		}
 	}
 }
@@ -157,25 +151,79 @@ void GameEngine::sUserInput()
 bool GameEngine::changeScene(const std::string& sceneName, std::shared_ptr<Scene> scene,
 	bool endCurrentScene)
 {
-	if (scene)
-	{
-		m_sceneMap[sceneName] = scene;
-	}
-	else if (m_sceneMap.find(sceneName) == m_sceneMap.end())
+	if (!scene && m_sceneMap.find(sceneName) == m_sceneMap.end())
 	{
 		std::cerr << "Warning: Scene does not exist: " << sceneName << std::endl;
 		return false;
 	}
 
-	if (endCurrentScene)
+	// the switch is applied by run() between frames, since a pipelined scene asks for it
+	// from its simulation thread while the main thread is still using the scene map
+	m_nextScene = sceneName;
+	m_nextScenePtr = scene;
+	m_endCurrentScene = endCurrentScene;
+	return true;
+}
+
+bool GameEngine::changeScene(const std::string& sceneName, SceneFactory factory)
+{
+	// a scene that was built before is resumed as it was left
+	if (m_sceneMap.find(sceneName) != m_sceneMap.end())
 	{
-		m_sceneMap.erase(m_sceneMap.find(m_currentScene));
+		return changeScene(sceneName, std::shared_ptr<Scene>());
 	}
 
-	m_nextScene = sceneName;
+	preloadScene(sceneName, std::move(factory), true);
 	return true;
 }
 
+void GameEngine::preloadScene(const std::string& sceneName, SceneFactory factory, bool activate)
+{
+	if (m_sceneMap.find(sceneName) != m_sceneMap.end()) return;
+
+	for (auto& loading : m_loadingScenes)
+	{
+		if (loading.name != sceneName) continue;
+		loading.activate = loading.activate || activate;
+		return;
+	}
+
+	// scene constructors leave the window alone until onEnterScene, so the current scene
+	// keeps running and drawing while the next one is built
+	m_loadingScenes.push_back({ sceneName, std::async(std::launch::async, std::move(factory)), activate });
+}
+
+void GameEngine::collectLoadedScenes()
+{
+	for (auto it = m_loadingScenes.begin(); it != m_loadingScenes.end();)
+	{
+		if (it->scene.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		m_sceneMap[it->name] = it->scene.get();
+		if (it->activate) changeScene(it->name, std::shared_ptr<Scene>());
+		it = m_loadingScenes.erase(it);
+	}
+}
+
+void GameEngine::finishSimulation()
+{
+	m_simulation.wait();
+}
+
+void GameEngine::setSimulationSpeed(size_t speed)
+{
+	m_simulationSpeed = std::max<size_t>(speed, 1);
+}
+
+size_t GameEngine::simulationSpeed() const
+{
+	return m_simulationSpeed;
+}
+
 void GameEngine::quit()
 {
 	m_running = false;
@@ -191,14 +239,53 @@ Assets& GameEngine::assets()
 	return m_assets;
 }
 
+Random GameEngine::randomStream()
+{
+	return m_random.stream(m_nextRandomStream++);
+}
+
 void GameEngine::update()
 {
 	if (!isRunning()) return;
 	if (m_sceneMap.empty()) return;
 
 	sUserInput();
-	currentScene()->simulate(m_simulationSpeed);
-	currentScene()->sRender();
+
+	// the simulation advances in fixed ticks for however much real time has passed, and
+	// rendering interpolates between the last two ticks; after a long stall only a few
+	// ticks are caught up so a slow frame never snowballs into slower ones
+	m_accumulator += m_deltaClock.restart();
+	size_t ticks = 0;
+	while (m_accumulator >= m_tickTime && ticks < m_maxTicksPerFrame)
+	{
+		m_accumulator -= m_tickTime;
+		ticks++;
+	}
+	if (m_accumulator >= m_tickTime) m_accumulator = sf::Time::Zero;
+
+	// every tick of the frame runs as one batch, at m_simulationSpeed gameplay ticks each
+	auto scene = currentScene();
+	size_t batch = ticks * m_simulationSpeed;
+	scene->setInterpolation(m_accumulator / m_tickTime);
+	if (scene->m_pipelined)
+	{
+		// the next frame is simulated on its own thread while this one is drawn from the
+		// snapshot the previous pass left behind, so a frame costs about max(sim, render)
+		// rather than their sum, for one frame of added latency
+		scene->publishFrame();
+		scene->takeActions();
+		m_simulation.submit([scene, batch]()
+		{
+			scene->applyActions();
+			if (batch > 0) scene->simulate(batch);
+			scene->prepareFrame();
+		});
+	}
+	else if (batch > 0)
+	{
+		scene->simulate(batch);
+	}
+	scene->sRender();
 
 	//ImGui::SFML::Render(m_window);
 	m_window.display();
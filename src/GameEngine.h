@@ -2,13 +2,27 @@
 
 #include "Scene.h"
 #include "Assets.hpp"
+#include "Random.hpp"
+#include "WorkerPool.hpp"
 
 #include <memory>
+#include <optional>
+#include <future>
+#include <atomic>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 using SceneMap = std::unordered_map<std::string, std::shared_ptr<Scene>>;
 
+// scene being constructed on a worker thread
+struct LoadingScene
+{
+	std::string name;
+	std::future<std::shared_ptr<Scene>> scene;
+	bool activate = false; // switch to it as soon as it is ready
+};
+
 class GameEngine
 {
 protected:
@@ -16,26 +30,47 @@ protected:
 	Assets m_assets;
 	std::string m_currentScene = "";
 	std::string m_nextScene = "";
+	std::shared_ptr<Scene> m_nextScenePtr;
+	bool m_endCurrentScene = false;
+	std::vector<LoadingScene> m_loadingScenes;
 	SceneMap m_sceneMap;
-	size_t m_simulationSpeed = 1;
+	std::atomic<size_t> m_simulationSpeed = 1; // set from action handlers on the simulation thread
 	sf::Clock m_deltaClock;
+	sf::Time m_tickTime = sf::seconds(1.0f / 60.0f);
+	sf::Time m_accumulator;
+	size_t m_maxTicksPerFrame = 5;
+	Random m_random; // never drawn from, only split into streams
+	std::atomic<uint64_t> m_nextRandomStream = 0;
+	std::atomic<unsigned> m_windowWidth = 0; // as of the last event poll
+	std::atomic<unsigned> m_windowHeight = 0;
 	bool m_running = true;
+	TaskThread m_simulation; // runs pipelined scenes' ticks alongside rendering
 
-	void init(const std::string& path);
+	void init(const std::string& path, std::optional<uint64_t> seed);
 	void update();
 	void sUserInput();
+	void finishSimulation();
+	void collectLoadedScenes();
 	std::shared_ptr<Scene> currentScene();
 
 public:
-	GameEngine(const std::string& path);
+	GameEngine(const std::string& path, std::optional<uint64_t> seed = std::nullopt);
 	bool changeScene(const std::string& sceneName,
 		std::shared_ptr<Scene> scene, bool endCurrentScene = false);
+	bool changeScene(const std::string& sceneName, SceneFactory factory);
+	void preloadScene(const std::string& sceneName, SceneFactory factory, bool activate = false);
 
 	void quit();
+	void setSimulationSpeed(size_t speed);
+	size_t simulationSpeed() const;
 	void run();
 
 	sf::RenderWindow& window();
+	// safe from any thread, unlike querying the window, which the main thread draws to
+	sf::Vector2u windowSize() const;
 	const Assets& assets() const;
 	Assets& assets();
+	// independent generator for one scene or thread; safe to call from any thread
+	Random randomStream();
 	bool isRunning();
 };
\ No newline at end of file
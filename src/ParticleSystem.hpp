@@ -2,6 +2,7 @@
 
 #include <SFML/Graphics.hpp>
 #include <vector>
+#include "Random.hpp"
 
 class ParticleSystem
 {
@@ -15,6 +16,7 @@ class ParticleSystem
 	sf::VertexArray m_vertices;
 	sf::Vector2u m_windowSize;
 	float m_size = 8;
+	Random m_random;
 
 	void resetParticle(size_t index, bool firstSpawn = false)
 	{
@@ -38,11 +40,11 @@ class ParticleSystem
 		m_vertices[6 * index + 4].color = color;
 		m_vertices[6 * index + 5].color = color;
 
-		float rx = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
-		float ry = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+		float rx = m_random.range(-1.0f, 1.0f);
+		float ry = m_random.range(-1.0f, 1.0f);
 		m_particles[index].velocity = sf::Vector2f(rx, ry);
 
-		m_particles[index].lifetime = 30 + rand() % 60;
+		m_particles[index].lifetime = m_random.range(30, 90);
 	}
 
 public:
@@ -60,9 +62,10 @@ public:
 		}
 	}
 
-	void init(sf::Vector2u windowSize)
+	void init(sf::Vector2u windowSize, const Random& random)
 	{
 		m_windowSize = windowSize;
+		m_random = random;
 		resetParticles();
 	}
 
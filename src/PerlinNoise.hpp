@@ -1,25 +1,34 @@
 #pragma once
 #include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Random.hpp"
 
 using Noise2DArray = std::vector<std::vector<float>>;
 using Noise3DArray = std::vector<std::vector<std::vector<float>>>;
+using NoiseVolume = std::vector<float>; // flat x-fastest block, index (z * ny + y) * nx + x
+
+struct NoiseBlock
+{
+    int x = 0, y = 0, z = 0;        // world voxel of the first sample
+    int nx = 1, ny = 1, nz = 1;     // number of samples along each axis
+    int stride = 1;                 // world voxels between neighbouring samples
+
+    size_t size() const { return size_t(nx) * ny * nz; }
+};
 
 class PerlinNoise
 {
 public:
     PerlinNoise() = default;
 
-    static Noise2DArray GenerateWhiteNoise(int width, int height)
+    static Noise2DArray GenerateWhiteNoise(int width, int height, Random& random)
     {
-		srand(time(nullptr));
 		Noise2DArray noise(width, std::vector<float>(height));
 
         for (int i = 0; i < width; i++)
         {
-			for (int j = 0; j < height; j++)
-			{
-				noise[i][j] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
-			}
+			random.fill(noise[i]);
         }
         return noise;
     }
@@ -113,4 +122,140 @@ public:
 
         return perlinNoise;
     }
+
+    static int FloorDiv(int a, int b)
+    {
+        return (a >= 0) ? (a / b) : ((a - b + 1) / b);
+    }
+
+    // hashed lattice value in [-1, 1]
+    static float LatticeValue(int x, int y, int z, uint64_t seed)
+    {
+        uint32_t h = Random::hash(seed, x, y, z);
+        return static_cast<float>(h >> 8) / float(0xffffff) * 2.0f - 1.0f;
+    }
+
+    // Trilinearly resamples a lattice whose points are `cell` voxels apart onto `block`
+    // and accumulates the result into `out`. Index/weight tables are built once per axis
+    // and rows are pre-blended in y and z, so the inner x loop is a plain multiply-add
+    // over contiguous arrays that the compiler can vectorise.
+    static void ResampleLattice3D(const NoiseVolume& lattice, const NoiseBlock& lBlock,
+        const NoiseBlock& block, bool smooth, float amplitude, NoiseVolume& out)
+    {
+        int cell = lBlock.stride;
+        auto buildAxis = [&](int origin, int count, int lOrigin, std::vector<int>& index, std::vector<float>& weight)
+        {
+            index.resize(count);
+            weight.resize(count);
+            for (int i = 0; i < count; i++)
+            {
+                int p = origin + i * block.stride - lOrigin;
+                index[i] = p / cell;
+                float t = float(p - index[i] * cell) / cell;
+                weight[i] = smooth ? t * t * (3.0f - 2.0f * t) : t;
+            }
+        };
+
+        std::vector<int> ix, iy, iz;
+        std::vector<float> wx, wy, wz;
+        buildAxis(block.x, block.nx, lBlock.x, ix, wx);
+        buildAxis(block.y, block.ny, lBlock.y, iy, wy);
+        buildAxis(block.z, block.nz, lBlock.z, iz, wz);
+
+        int lnx = lBlock.nx, lny = lBlock.ny;
+        std::vector<float> row(lnx);
+        for (int k = 0; k < block.nz; k++)
+        {
+            for (int j = 0; j < block.ny; j++)
+            {
+                const float* c00 = &lattice[(size_t(iz[k]) * lny + iy[j]) * lnx];
+                const float* c01 = c00 + lnx;
+                const float* c10 = c00 + size_t(lny) * lnx;
+                const float* c11 = c10 + lnx;
+                float ty = wy[j], tz = wz[k];
+                for (int l = 0; l < lnx; l++)
+                {
+                    float a = c00[l] + (c01[l] - c00[l]) * ty;
+                    float b = c10[l] + (c11[l] - c10[l]) * ty;
+                    row[l] = a + (b - a) * tz;
+                }
+
+                float* dst = &out[(size_t(k) * block.ny + j) * block.nx];
+                const int* idx = ix.data();
+                const float* w = wx.data();
+                const float* r = row.data();
+                for (int i = 0; i < block.nx; i++)
+                {
+                    float a = r[idx[i]];
+                    dst[i] += amplitude * (a + (r[idx[i] + 1] - a) * w[i]);
+                }
+            }
+        }
+    }
+
+    // Fractal 3D value noise in [-1, 1] sampled at every point of `block`.
+    static void GenerateDensityNoise(NoiseVolume& out, const NoiseBlock& block,
+        int baseCell, int octaveCount, uint64_t seed)
+    {
+        out.assign(block.size(), 0.0f);
+
+        NoiseVolume lattice;
+        float persistance = 0.5f;
+        float amplitude = 1.0f;
+        float totalAmplitude = 0.0f;
+        int cell = baseCell;
+
+        for (int octave = 0; octave < octaveCount && cell >= 2; octave++, cell /= 2)
+        {
+            // lattice points covering the block, plus one for the upper interpolation corner
+            NoiseBlock lBlock;
+            lBlock.stride = cell;
+            lBlock.x = FloorDiv(block.x, cell) * cell;
+            lBlock.y = FloorDiv(block.y, cell) * cell;
+            lBlock.z = FloorDiv(block.z, cell) * cell;
+            lBlock.nx = FloorDiv(block.x + (block.nx - 1) * block.stride, cell) - lBlock.x / cell + 2;
+            lBlock.ny = FloorDiv(block.y + (block.ny - 1) * block.stride, cell) - lBlock.y / cell + 2;
+            lBlock.nz = FloorDiv(block.z + (block.nz - 1) * block.stride, cell) - lBlock.z / cell + 2;
+
+            lattice.resize(lBlock.size());
+            uint64_t octaveSeed = seed + octave * 0x632be59bd9b4e019ULL;
+            size_t n = 0;
+            for (int k = 0; k < lBlock.nz; k++)
+                for (int j = 0; j < lBlock.ny; j++)
+                    for (int i = 0; i < lBlock.nx; i++)
+                        lattice[n++] = LatticeValue(lBlock.x / cell + i, lBlock.y / cell + j,
+                            lBlock.z / cell + k, octaveSeed);
+
+            ResampleLattice3D(lattice, lBlock, block, true, amplitude, out);
+            totalAmplitude += amplitude;
+            amplitude *= persistance;
+        }
+
+        if (totalAmplitude > 0.0f)
+        {
+            float norm = 1.0f / totalAmplitude;
+            for (float& v : out) v *= norm;
+        }
+    }
+
+    // Same field as GenerateDensityNoise, but the octaves are only evaluated every
+    // `step` voxels and the dense block is filled by trilinear interpolation.
+    static void GenerateCoarseDensityNoise(NoiseVolume& out, const NoiseBlock& block,
+        int step, int baseCell, int octaveCount, uint64_t seed)
+    {
+        NoiseBlock coarse;
+        coarse.stride = step;
+        coarse.x = FloorDiv(block.x, step) * step;
+        coarse.y = FloorDiv(block.y, step) * step;
+        coarse.z = FloorDiv(block.z, step) * step;
+        coarse.nx = FloorDiv(block.x + block.nx - 1, step) - coarse.x / step + 2;
+        coarse.ny = FloorDiv(block.y + block.ny - 1, step) - coarse.y / step + 2;
+        coarse.nz = FloorDiv(block.z + block.nz - 1, step) - coarse.z / step + 2;
+
+        NoiseVolume coarseNoise;
+        GenerateDensityNoise(coarseNoise, coarse, baseCell, octaveCount, seed);
+
+        out.assign(block.size(), 0.0f);
+        ResampleLattice3D(coarseNoise, coarse, block, false, 1.0f, out);
+    }
 };
\ No newline at end of file
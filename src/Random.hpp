@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Utils.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Small value-type generator built on Utils::lehmer64. Each instance owns its state,
+// so separate streams can be handed to worker threads, chunks or subsystems without
+// locking, and the same seed always reproduces the same sequence.
+class Random
+{
+	uint64_t m_state = 1;
+
+public:
+	Random() = default;
+	explicit Random(uint64_t seed)
+		: m_state(mix(seed) | 1) { } // lehmer64 needs an odd state
+
+	// splitmix64 finaliser; a bijection, so neighbouring seeds land far apart and forcing
+	// the state odd afterwards no longer folds seeds 2k and 2k+1 together
+	static uint64_t mix(uint64_t x)
+	{
+		x += 0x9e3779b97f4a7c15ULL;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+
+	// 64-bit seed for stream `id` of `seed`
+	static uint64_t derive(uint64_t seed, uint64_t id)
+	{
+		return mix(mix(seed) ^ (id * 0x9e3779b97f4a7c15ULL));
+	}
+
+	// stateless hash of a lattice/grid coordinate, e.g. for noise or per-chunk streams
+	static uint32_t hash(uint64_t seed, int x, int y, int z)
+	{
+		uint64_t h = derive(seed, uint32_t(x));
+		h = derive(h, uint32_t(y));
+		return static_cast<uint32_t>(derive(h, uint32_t(z)));
+	}
+
+	uint64_t seed() const
+	{
+		return m_state;
+	}
+
+	// independent child stream; cheap enough to call per thread, per chunk or per frame
+	Random stream(uint64_t id) const
+	{
+		return Random(derive(m_state, id));
+	}
+
+	Random stream(int x, int y, int z) const
+	{
+		return Random(derive(m_state, hash(m_state, x, y, z)));
+	}
+
+	uint32_t next()
+	{
+		return Utils::lehmer64(m_state);
+	}
+
+	uint64_t next64()
+	{
+		uint64_t hi = next();
+		return (hi << 32) | next();
+	}
+
+	// uniform in [0, 1)
+	float nextFloat()
+	{
+		return (next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float range(float lo, float hi)
+	{
+		return lo + (hi - lo) * nextFloat();
+	}
+
+	// uniform in [lo, hi)
+	int range(int lo, int hi)
+	{
+		return lo + static_cast<int>((uint64_t(next()) * uint32_t(hi - lo)) >> 32);
+	}
+
+	// same sequence as repeated nextFloat(), with the state kept in a register
+	void fill(float* out, size_t count, float lo = 0.0f, float hi = 1.0f)
+	{
+		uint64_t state = m_state;
+		float scale = (hi - lo) * (1.0f / 16777216.0f);
+		for (size_t i = 0; i < count; i++)
+		{
+			state *= 0xda942042e4dd58b5ULL;
+			out[i] = lo + static_cast<float>(state >> 40) * scale;
+		}
+		m_state = state;
+	}
+
+	void fill(std::vector<float>& out, float lo = 0.0f, float hi = 1.0f)
+	{
+		fill(out.data(), out.size(), lo, hi);
+	}
+};
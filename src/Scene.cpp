@@ -2,21 +2,40 @@
 #include "GameEngine.h"
 
 Scene::Scene(GameEngine* gameEngine)
-	: m_game(gameEngine) { }
+	: m_game(gameEngine)
+	, m_random(gameEngine->randomStream())
+	, m_windowSize(gameEngine->windowSize()) { }
 
 void Scene::setPaused(bool paused)
 {
 	m_paused = paused;
 }
 
+void Scene::setInterpolation(float alpha)
+{
+	m_interpolation = alpha;
+}
+
 size_t Scene::width() const
 {
-	return m_game->window().getSize().x;
+	return m_windowSize.x;
 }
 
 size_t Scene::height() const
 {
-	return m_game->window().getSize().y;
+	return m_windowSize.y;
+}
+
+sf::Vector2f Scene::mapPixelToCoords(const sf::Vector2i& pixel, const sf::View& view) const
+{
+	// same mapping as sf::RenderTarget's, from the window size snapshot instead of the window
+	sf::FloatRect viewport = view.getViewport();
+	sf::Vector2f size(m_windowSize);
+	sf::Vector2f origin(viewport.position.x * size.x, viewport.position.y * size.y);
+	sf::Vector2f extent(viewport.size.x * size.x, viewport.size.y * size.y);
+	sf::Vector2f normalized(-1.f + 2.f * (pixel.x - origin.x) / extent.x,
+		1.f - 2.f * (pixel.y - origin.y) / extent.y);
+	return view.getInverseTransform().transformPoint(normalized);
 }
 
 size_t Scene::currentFrame() const
@@ -34,14 +53,33 @@ const MouseActionMap& Scene::getMouseActionMap() const
 	return m_mouseActionMap;
 }
 
-void Scene::registerKeyAction(sf::Keyboard::Scan keyCode, const std::string& name)
+void Scene::registerKeyAction(sf::Keyboard::Scan keyCode, ActionId action)
 {
-	m_keyActionMap[keyCode] = name;
+	if (keyCode == sf::Keyboard::Scan::Unknown) return;
+	m_keyActionMap[size_t(keyCode)] = action;
 }
 
-void Scene::registerMouseAction(sf::Mouse::Button mouseButton, const std::string& name)
+void Scene::registerMouseAction(sf::Mouse::Button mouseButton, ActionId action)
 {
-	m_mouseActionMap[mouseButton] = name;
+	m_mouseActionMap[size_t(mouseButton)] = action;
+}
+
+void Scene::registerActionHandler(ActionId action, ActionType type, ActionHandler handler)
+{
+	if (action >= m_actionHandlers.size()) m_actionHandlers.resize(action + 1);
+	m_actionHandlers[action][size_t(type)] = std::move(handler);
+}
+
+ActionId Scene::keyAction(sf::Keyboard::Scan keyCode) const
+{
+	size_t index = size_t(keyCode);
+	return index < m_keyActionMap.size() ? m_keyActionMap[index] : ActionId(EngineAction::None);
+}
+
+ActionId Scene::mouseAction(sf::Mouse::Button mouseButton) const
+{
+	size_t index = size_t(mouseButton);
+	return index < m_mouseActionMap.size() ? m_mouseActionMap[index] : ActionId(EngineAction::None);
 }
 
 bool Scene::hasEnded() const
@@ -51,29 +89,75 @@ bool Scene::hasEnded() const
 
 void Scene::simulate(const size_t frames)
 {
+	// only the state after the last tick of a batch is ever drawn, so scenes can leave
+	// streaming and other presentation work to that one
 	for (size_t i = 0; i < frames; i++)
 	{
+		m_lastTick = i + 1 == frames;
 		update();
+		m_currentFrame++;
 	}
-	m_currentFrame++;
+	m_lastTick = true;
 }
 
 void Scene::doAction(const Action& action)
 {
+	// a pipelined scene is mid-simulation while input is polled, so its actions are
+	// held until the next simulation pass starts
+	if (m_pipelined)
+	{
+		m_pendingActions.push_back(action);
+		return;
+	}
 	sDoAction(action);
 }
 
-void Scene::playSound(const std::string& name, float volume)
+void Scene::sDoAction(const Action& action)
+{
+	if (action.m_id >= m_actionHandlers.size()) return;
+
+	auto& handler = m_actionHandlers[action.m_id][size_t(action.m_type)];
+	if (handler) handler(action);
+}
+
+void Scene::takeActions()
+{
+	// runs on the main thread between simulation passes, so the window can be asked here
+	m_windowSize = m_game->windowSize();
+	std::swap(m_pendingActions, m_tickActions);
+	m_pendingActions.clear();
+}
+
+void Scene::applyActions()
+{
+	for (auto& action : m_tickActions)
+	{
+		sDoAction(action);
+	}
+	m_tickActions.clear();
+}
+
+void Scene::prepareFrame()
+{
+
+}
+
+void Scene::publishFrame()
+{
+
+}
+
+void Scene::playSound(SoundHandle handle, float volume)
 {
-	auto& sound = m_game->assets().getSound(name);
+	auto& sound = m_game->assets().getSound(handle);
 	sound.setVolume(volume);
 	sound.play();
 }
 
-void Scene::playVariablePitchSound(const std::string& name, float volume)
+void Scene::playVariablePitchSound(SoundHandle handle, float volume)
 {
-	auto& sound = m_game->assets().getSound(name);
-	float pitch = 0.8f + static_cast<float>(rand()) / RAND_MAX * 0.4f; // range [0.8, 1.2]
+	auto& sound = m_game->assets().getSound(handle);
+	float pitch = m_random.range(0.8f, 1.2f);
 	sound.setPitch(pitch);
 	sound.setVolume(volume);
 	sound.play();
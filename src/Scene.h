@@ -3,13 +3,24 @@
 #include "Action.hpp"
 #include "EntityManager.hpp"
 #include "MemoryPool.hpp"
+#include "AssetHandle.hpp"
+#include "Random.hpp"
 
 #include <memory>
+#include <vector>
+#include <array>
+#include <functional>
 
 class GameEngine;
+class Scene;
 
-using KeyActionMap = std::unordered_map<sf::Keyboard::Scan, std::string>;
-using MouseActionMap = std::unordered_map<sf::Mouse::Button, std::string>;
+using SceneFactory = std::function<std::shared_ptr<Scene>()>;
+
+// flat tables indexed by scancode and button, EngineAction::None where nothing is bound
+using KeyActionMap = std::array<ActionId, sf::Keyboard::ScancodeCount>;
+using MouseActionMap = std::array<ActionId, sf::Mouse::ButtonCount>;
+using ActionHandler = std::function<void(const Action&)>;
+using ActionHandlers = std::array<ActionHandler, size_t(ActionType::Count)>;
 
 class Scene
 {
@@ -17,37 +28,54 @@ public:
 	GameEngine* m_game = nullptr;
 	EntityManager m_entityManager;
 	MemoryPool m_memoryPool;
-	KeyActionMap m_keyActionMap;
-	MouseActionMap m_mouseActionMap;
+	Random m_random; // this scene's own stream, only used from the thread running it
+	sf::Vector2u m_windowSize; // snapshot for the simulation thread, refreshed by takeActions
+	KeyActionMap m_keyActionMap = {};
+	MouseActionMap m_mouseActionMap = {};
+	std::vector<ActionHandlers> m_actionHandlers; // indexed by action id, then type
 	bool m_paused = false;
 	bool m_hasEnded = false;
 	size_t m_currentFrame = 0;
+	float m_interpolation = 1.0f; // fraction of a tick rendering is ahead of the last update
+	bool m_pipelined = false; // simulated on its own thread while the previous frame is drawn
+	bool m_lastTick = true; // false for the ticks of a batch whose state is never drawn
+	std::vector<Action> m_pendingActions; // input polled while the simulation was running
+	std::vector<Action> m_tickActions;
 
 	virtual void onEnd() = 0;
 	void setPaused(bool paused);
+	void setInterpolation(float alpha);
 
 	Scene() = default;
 	Scene(GameEngine* gameEngine);
 
 	virtual void update() = 0;
-	virtual void sDoAction(const Action& action) = 0;
+	virtual void sDoAction(const Action& action);
 	virtual void sRender() = 0;
 	virtual void onExitScene() = 0;
 	virtual void onEnterScene() = 0;
 
 	virtual void doAction(const Action& action);
+	virtual void prepareFrame();
+	virtual void publishFrame();
+	void takeActions();
+	void applyActions();
 	void simulate(const size_t frames);
-	void registerKeyAction(sf::Keyboard::Scan inputKey, const std::string& actionName);
-	void registerMouseAction(sf::Mouse::Button inputButton, const std::string& actionName);
+	void registerKeyAction(sf::Keyboard::Scan inputKey, ActionId action);
+	void registerMouseAction(sf::Mouse::Button inputButton, ActionId action);
+	void registerActionHandler(ActionId action, ActionType type, ActionHandler handler);
+	ActionId keyAction(sf::Keyboard::Scan inputKey) const;
+	ActionId mouseAction(sf::Mouse::Button inputButton) const;
 
 	size_t width() const;
 	size_t height() const;
+	sf::Vector2f mapPixelToCoords(const sf::Vector2i& pixel, const sf::View& view) const;
 	size_t currentFrame() const;
 
 	bool hasEnded() const;
 	const KeyActionMap& getKeyActionMap() const;
 	const MouseActionMap& getMouseActionMap() const;
 
-	void playSound(const std::string& name, float volume);
-	void playVariablePitchSound(const std::string& name, float volume);
+	void playSound(SoundHandle sound, float volume);
+	void playVariablePitchSound(SoundHandle sound, float volume);
 };
\ No newline at end of file
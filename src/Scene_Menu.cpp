@@ -16,11 +16,28 @@ Scene_Menu::Scene_Menu(GameEngine* gameEngine)
 
 void Scene_Menu::init()
 {
-	auto& window = m_game->window();
-	window.setView(window.getDefaultView());
+	registerMouseAction(sf::Mouse::Button::Left, MenuAction::LeftClick);
+	registerMouseAction(sf::Mouse::Button::Right, MenuAction::RightClick);
+
+	registerActionHandler(MenuAction::Quit, ActionType::Start, [this](const Action&)
+	{
+		onEnd();
+	});
+	registerActionHandler(EngineAction::MouseMove, ActionType::Start, [this](const Action& action)
+	{
+		m_mousePos = action.m_mousePos;
+	});
+	registerActionHandler(MenuAction::LeftClick, ActionType::Start, [this](const Action& action)
+	{
+		m_mousePos = action.m_mousePos;
+		select();
+	});
 
-	registerMouseAction(sf::Mouse::Button::Left, "LEFT_CLICK");
-	registerMouseAction(sf::Mouse::Button::Right, "RIGHT_CLICK");
+	auto& assets = m_game->assets();
+	m_buttonAnimation = assets.animationHandle("Button");
+	m_buttonHoverAnimation = assets.animationHandle("ButtonHover");
+	m_font = assets.fontHandle("FutureMillennium");
+	m_hoverSound = assets.soundHandle("BubblierStep");
 
 	loadMenu();
 }
@@ -33,17 +50,17 @@ void Scene_Menu::loadMenu()
 	m_memoryPool = MemoryPool(MAX_ENTITIES);
 
 	auto title = m_entityManager.addEntity(m_memoryPool, "ui", "Game Engine");
-	auto& tAnimation = title.add<CAnimation>(m_memoryPool, m_game->assets().getAnimation("ButtonHover"), true).animation;
+	title.add<CAnimation>(m_memoryPool, m_buttonHoverAnimation, m_currentFrame, true);
 	auto& tTransform = title.add<CTransform>(m_memoryPool, Vec2f(width() / 2, height() * 0.15f));
 	tTransform.scale = Vec2f(2.f, 1.2f);
 
 	auto playButton = m_entityManager.addEntity(m_memoryPool, "button", "Start");
-	playButton.add<CAnimation>(m_memoryPool, m_game->assets().getAnimation("Button"), true);
+	playButton.add<CAnimation>(m_memoryPool, m_buttonAnimation, m_currentFrame, true);
 	auto& pbTransform = playButton.add<CTransform>(m_memoryPool, Vec2f(width() / 2, height() * 0.4f));
 	playButton.add<CState>(m_memoryPool, "unselected");
 
 	auto quitButton = m_entityManager.addEntity(m_memoryPool, "button", "Quit");
-	quitButton.add<CAnimation>(m_memoryPool, m_game->assets().getAnimation("Button"), true);
+	quitButton.add<CAnimation>(m_memoryPool, m_buttonAnimation, m_currentFrame, true);
 	auto& qTransform = quitButton.add<CTransform>(m_memoryPool, Vec2f(width() / 2, height() * 0.6f));
 	quitButton.add<CState>(m_memoryPool, "unselected");
 }
@@ -61,8 +78,8 @@ void Scene_Menu::sHover()
 	{
 		auto& buttonState = button.get<CState>(m_memoryPool).state;
 		auto& buttonTrans = button.get<CTransform>(m_memoryPool);
-		auto& buttonAni = button.get<CAnimation>(m_memoryPool);
-		if (Utils::isInside(m_mousePos, buttonTrans, buttonAni))
+		auto& buttonClip = m_game->assets().getAnimation(button.get<CAnimation>(m_memoryPool).clip);
+		if (Utils::isInside(m_mousePos, buttonTrans, buttonClip))
 			buttonState = "selected";
 		else
 			buttonState = "unselected";
@@ -74,16 +91,16 @@ void Scene_Menu::sAnimation()
 	for (Entity button : m_entityManager.getEntities("button"))
 	{
 		auto& buttonState = button.get<CState>(m_memoryPool).state;
-		auto& buttonAnimation = button.get<CAnimation>(m_memoryPool).animation;
+		auto& buttonAnimation = button.get<CAnimation>(m_memoryPool);
 
-		if (buttonState == "selected" && buttonAnimation.m_name != "ButtonHover")
+		if (buttonState == "selected" && buttonAnimation.clip != m_buttonHoverAnimation)
 		{
-			button.add<CAnimation>(m_memoryPool, m_game->assets().getAnimation("ButtonHover"), true);
-			playSound("BubblierStep", 15);
+			buttonAnimation = CAnimation(m_buttonHoverAnimation, m_currentFrame, true);
+			playSound(m_hoverSound, 15);
 		}
-		else if (buttonState == "unselected" && buttonAnimation.m_name != "Button")
+		else if (buttonState == "unselected" && buttonAnimation.clip != m_buttonAnimation)
 		{
-			button.add<CAnimation>(m_memoryPool, m_game->assets().getAnimation("Button"), true);
+			buttonAnimation = CAnimation(m_buttonAnimation, m_currentFrame, true);
 		}
 	}
 }
@@ -102,6 +119,17 @@ void Scene_Menu::onEnterScene()
 {
 	auto& window = m_game->window();
 	window.setView(window.getDefaultView());
+
+	// start building the game in the background so Start rarely has to wait for it
+	m_game->preloadScene("PLAY", playSceneFactory());
+}
+
+SceneFactory Scene_Menu::playSceneFactory() const
+{
+	return [game = m_game]() -> std::shared_ptr<Scene>
+	{
+		return std::make_shared<Scene_Play>(game, "assets/play.txt");
+	};
 }
 
 void Scene_Menu::select()
@@ -109,34 +137,16 @@ void Scene_Menu::select()
 	for (Entity button : m_entityManager.getEntities("button"))
 	{
 		auto& bTrans = button.get<CTransform>(m_memoryPool);
-		auto& bAni = button.get<CAnimation>(m_memoryPool);
-		if (!Utils::isInside(m_mousePos, bTrans, bAni)) continue;
+		auto& bClip = m_game->assets().getAnimation(button.get<CAnimation>(m_memoryPool).clip);
+		if (!Utils::isInside(m_mousePos, bTrans, bClip)) continue;
 
 		if (button.name(m_memoryPool) == "Start")
-			m_game->changeScene("PLAY", std::make_shared<Scene_Play>(m_game, "assets/play.txt"));
+			m_game->changeScene("PLAY", playSceneFactory());
 		else if (button.name(m_memoryPool) == "Quit")
 			onEnd();
 	}
 }
 
-void Scene_Menu::sDoAction(const Action& action)
-{
-	if (action.m_type == "START")
-	{
-		if (action.m_name == "QUIT")
-		{
-			onEnd();
-		}
-		else if (action.m_name == "MOUSE_MOVE")
-			m_mousePos = action.m_mousePos;
-		else if (action.m_name == "LEFT_CLICK")
-		{
-			m_mousePos = action.m_mousePos;
-			select();
-		}
-	}
-}
-
 void Scene_Menu::sRender()
 {
     auto& window = m_game->window();
@@ -146,14 +156,16 @@ void Scene_Menu::sRender()
 	{
 		if (!entity.has<CAnimation>(m_memoryPool)) continue;
 
-		auto& animation = entity.get<CAnimation>(m_memoryPool).animation;
+		auto& animation = entity.get<CAnimation>(m_memoryPool);
+		auto& clip = m_game->assets().getAnimation(animation.clip);
 		auto& transform = entity.get<CTransform>(m_memoryPool);
 
-		animation.m_sprite.setPosition(transform.pos);
-		animation.m_sprite.setScale(transform.scale);
-		window.draw(animation.m_sprite);
+		auto sprite = clip.makeSprite(clip.frameAt(m_currentFrame - animation.startTick, animation.repeat));
+		sprite.setPosition(transform.pos);
+		sprite.setScale(transform.scale);
+		window.draw(sprite);
 
-		auto buttonText = sf::Text(m_game->assets().getFont("FutureMillennium"));
+		auto buttonText = sf::Text(m_game->assets().getFont(m_font));
 
 		if (entity.tag(m_memoryPool) == "ui")
 			buttonText.setCharacterSize(150);
@@ -7,21 +7,35 @@
 
 #include "EntityManager.hpp"
 
+namespace MenuAction
+{
+	enum : ActionId
+	{
+		Quit = EngineAction::SceneFirst,
+		LeftClick,
+		RightClick
+	};
+}
+
 class Scene_Menu : public Scene
 {
 public:
 	std::string m_musicName;
 	Vec2f m_mousePos;
+	AnimationHandle m_buttonAnimation;
+	AnimationHandle m_buttonHoverAnimation;
+	FontHandle m_font;
+	SoundHandle m_hoverSound;
 
 	void init();
 	void loadMenu();
 	void update();
 	void onEnd();
-	void sDoAction(const Action& action);
 	void onExitScene();
 	void onEnterScene();
 
 	void select();
+	SceneFactory playSceneFactory() const;
 	void sHover();
 	void sAnimation();
 
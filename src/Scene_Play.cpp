@@ -9,6 +9,7 @@
 #include "Utils.hpp"
 #include "PerlinNoise.hpp"
 #include "Entity.hpp"
+#include "WorkerPool.hpp"
 
 #include <fstream>
 #include <iostream>
@@ -16,6 +17,7 @@
 #include <cmath>
 #include <math.h>
 #include <algorithm>
+#include <climits>
 
 Scene_Play::Scene_Play(GameEngine* gameEngine, const std::string& levelPath)
 	: Scene(gameEngine)
@@ -26,30 +28,120 @@ Scene_Play::Scene_Play(GameEngine* gameEngine, const std::string& levelPath)
 
 void Scene_Play::init(const std::string& levelPath)
 {
-	registerMouseAction(sf::Mouse::Button::Left, "LEFT_CLICK");
-	registerMouseAction(sf::Mouse::Button::Right, "RIGHT_CLICK");
+	registerActions();
+	m_pipelined = true;
 
-	registerKeyAction(sf::Keyboard::Scan::Escape, "ESCAPE");
-
-	registerKeyAction(sf::Keyboard::Scan::Space, "UP");
-	registerKeyAction(sf::Keyboard::Scan::LShift, "DOWN");
-
-	registerKeyAction(sf::Keyboard::Scan::A, "LEFT");
-	registerKeyAction(sf::Keyboard::Scan::D, "RIGHT");
-	registerKeyAction(sf::Keyboard::Scan::W, "FORWARD");
-	registerKeyAction(sf::Keyboard::Scan::S, "BACKWARD");
+	buildTileMeshTables();
+	m_debugOverlay.init(m_game->assets().getFont("FutureMillennium"), 20, height() * 0.035f);
 
 	m_cameraView.setSize(sf::Vector2f(width(), height()));
 	m_cameraView.zoom(1.0f);
-	m_game->window().setView(m_cameraView);
+
+	m_terrainSeed = m_random.next64();
 
 	loadLevel(levelPath);
 	generateHeightMap();
+	computeChunkColumnBounds();
+}
+
+void Scene_Play::registerActions()
+{
+	registerMouseAction(sf::Mouse::Button::Left, PlayAction::LeftClick);
+	registerMouseAction(sf::Mouse::Button::Right, PlayAction::RightClick);
+
+	registerKeyAction(sf::Keyboard::Scan::Escape, PlayAction::Escape);
+
+	registerKeyAction(sf::Keyboard::Scan::Space, PlayAction::Up);
+	registerKeyAction(sf::Keyboard::Scan::LShift, PlayAction::Down);
+
+	registerKeyAction(sf::Keyboard::Scan::A, PlayAction::Left);
+	registerKeyAction(sf::Keyboard::Scan::D, PlayAction::Right);
+	registerKeyAction(sf::Keyboard::Scan::W, PlayAction::Forward);
+	registerKeyAction(sf::Keyboard::Scan::S, PlayAction::Backward);
+
+	registerKeyAction(sf::Keyboard::Scan::T, PlayAction::ToggleTerrain);
+	registerKeyAction(sf::Keyboard::Scan::B, PlayAction::Benchmark);
+	registerKeyAction(sf::Keyboard::Scan::C, PlayAction::ToggleCutaway);
+	registerKeyAction(sf::Keyboard::Scan::F3, PlayAction::ToggleOverlay);
+	registerKeyAction(sf::Keyboard::Scan::F, PlayAction::FastForward);
+
+	// movement keys hold their input flag down for as long as the key is
+	const std::pair<ActionId, bool CInput::*> movement[] = {
+		{ PlayAction::Left, &CInput::left },
+		{ PlayAction::Right, &CInput::right },
+		{ PlayAction::Up, &CInput::up },
+		{ PlayAction::Down, &CInput::down },
+		{ PlayAction::Forward, &CInput::forward },
+		{ PlayAction::Backward, &CInput::backward }
+	};
+	for (auto& [action, flag] : movement)
+	{
+		registerActionHandler(action, ActionType::Start, [this, flag](const Action&)
+		{
+			player().get<CInput>(m_memoryPool).*flag = true;
+		});
+		registerActionHandler(action, ActionType::End, [this, flag](const Action&)
+		{
+			player().get<CInput>(m_memoryPool).*flag = false;
+		});
+	}
+
+	registerActionHandler(PlayAction::Escape, ActionType::Start, [this](const Action&)
+	{
+		returnToMenu();
+	});
+	registerActionHandler(PlayAction::ToggleTerrain, ActionType::Start, [this](const Action&)
+	{
+		m_terrainMode = m_terrainMode == TerrainMode::HeightMap
+			? TerrainMode::Density : TerrainMode::HeightMap;
+		despawnAllChunks();
+	});
+	registerActionHandler(PlayAction::Benchmark, ActionType::Start, [this](const Action&)
+	{
+		benchmarkChunkGeneration();
+	});
+	registerActionHandler(PlayAction::ToggleCutaway, ActionType::Start, [this](const Action&)
+	{
+		m_cutaway = !m_cutaway;
+	});
+	registerActionHandler(PlayAction::FastForward, ActionType::Start, [this](const Action&)
+	{
+		m_game->setSimulationSpeed(m_game->simulationSpeed() == 1 ? m_fastForwardSpeed : 1);
+	});
+	registerActionHandler(PlayAction::ToggleOverlay, ActionType::Start, [this](const Action&)
+	{
+		m_showDebugOverlay = !m_showDebugOverlay;
+	});
+
+	// mouse positions are mapped through the simulation's own view and the window size
+	// snapshot; the window itself belongs to the render side
+	registerActionHandler(PlayAction::LeftClick, ActionType::Start, [this](const Action& action)
+	{
+		m_mousePos = mapPixelToCoords(action.m_mousePos, m_cameraView);
+		Grid3D columnTop;
+		if (pickColumn(m_mousePos, columnTop)) digColumn(columnTop.x, columnTop.y);
+	});
+	registerActionHandler(PlayAction::RightClick, ActionType::Start, [this](const Action& action)
+	{
+		m_mousePos = mapPixelToCoords(action.m_mousePos, m_cameraView);
+		Grid3D columnTop;
+		if (pickColumn(m_mousePos, columnTop)) raiseColumn(columnTop.x, columnTop.y);
+	});
+	registerActionHandler(EngineAction::MouseMove, ActionType::Start, [this](const Action& action)
+	{
+		m_mousePos = mapPixelToCoords(action.m_mousePos, m_cameraView);
+	});
+	registerActionHandler(EngineAction::MouseScroll, ActionType::Start, [this](const Action& action)
+	{
+		float zoomFactor = action.m_mouseScrollDelta > 0 ? 0.9f : 1.1f;
+		m_cameraView.zoom(zoomFactor);
+	});
 }
 
 void Scene_Play::loadLevel(const std::string& filename)
 {
-	const static size_t MAX_ENTITIES = m_chunkSize3D.volume() * 100;
+	// tiles are plain chunk data, so entities are only the player, chunks and actors
+	const static size_t MAX_ENTITIES = 16384;
 
 	m_entityManager = EntityManager();
 	m_memoryPool = MemoryPool(MAX_ENTITIES);
@@ -65,7 +157,8 @@ void Scene_Play::generateHeightMap()
 	m_heightMap.clear();
 	m_heightMap.reserve(w * h);
 
-	Noise2DArray whiteNoise = PerlinNoise::GenerateWhiteNoise(w, h);
+	Random terrainRandom(m_terrainSeed);
+	Noise2DArray whiteNoise = PerlinNoise::GenerateWhiteNoise(w, h, terrainRandom);
 	Noise2DArray perlinNoise = PerlinNoise::GeneratePerlinNoise(whiteNoise, 6);
 
 	for (int j = 0; j < h; ++j)            // note: row (y) outer for cache
@@ -79,6 +172,81 @@ void Scene_Play::generateHeightMap()
 	}
 }
 
+void Scene_Play::computeChunkColumnBounds()
+{
+	int cw = m_chunkSize3D.x, ch = m_chunkSize3D.y;
+	m_numChunks3D.x = (int(m_gridSize3D.x) + cw - 1) / cw;
+	m_numChunks3D.y = (int(m_gridSize3D.y) + ch - 1) / ch;
+
+	m_chunkColumnBounds.assign(int(m_numChunks3D.x) * int(m_numChunks3D.y), ChunkColumnBounds());
+	for (int cy = 0; cy < m_numChunks3D.y; ++cy)
+	{
+		for (int cx = 0; cx < m_numChunks3D.x; ++cx)
+		{
+			computeChunkColumnBounds(cx, cy);
+		}
+	}
+}
+
+void Scene_Play::computeChunkColumnBounds(int cx, int cy)
+{
+	if (cx < 0 || cx >= m_numChunks3D.x || cy < 0 || cy >= m_numChunks3D.y) return;
+
+	int cw = int(m_chunkSize3D.x), ch = int(m_chunkSize3D.y);
+	auto& bounds = m_chunkColumnBounds[cy * int(m_numChunks3D.x) + cx];
+	bounds.minHeight = INT_MAX;
+	bounds.maxHeight = INT_MIN;
+
+	// start one column early so the -x/-y border that can expose our faces is included
+	for (int y = cy * ch - 1; y < (cy + 1) * ch; ++y)
+	{
+		for (int x = cx * cw - 1; x < (cx + 1) * cw; ++x)
+		{
+			// columns outside the world are air, so they can never bury the chunk
+			int surface = columnHeight(x, y);
+			bool border = x < cx * cw || y < cy * ch;
+			if (!border) bounds.minHeight = std::min(bounds.minHeight, surface);
+			bounds.maxHeight = std::max(bounds.maxHeight, surface);
+		}
+	}
+}
+
+int Scene_Play::columnHeight(int x, int y) const
+{
+	// columns outside the world are treated as air
+	if (x < 0 || x >= m_gridSize3D.x || y < 0 || y >= m_gridSize3D.y) return INT_MAX;
+	return m_heightMap[y * int(m_gridSize3D.x) + x];
+}
+
+int Scene_Play::exposedEnd(int x, int y) const
+{
+	// a voxel is only visible through its top, -x or -y face, so everything
+	// below the deepest of those openings is hidden
+	int surface = columnHeight(x, y);
+	if (surface == INT_MAX) return INT_MAX;
+	return std::max({ surface + 1, columnHeight(x - 1, y), columnHeight(x, y - 1) });
+}
+
+ChunkFill Scene_Play::classifyChunk(const Grid3D& chunkPos) const
+{
+	int cx = chunkPos.x, cy = chunkPos.y;
+	if (cx < 0 || cx >= m_numChunks3D.x || cy < 0 || cy >= m_numChunks3D.y)
+		return ChunkFill::Empty;
+
+	// terrain is solid for z >= column height, so a chunk is air if every surface
+	// lies below its bottom and buried if every surface (and its border) lies above its top
+	const auto& bounds = m_chunkColumnBounds[cy * int(m_numChunks3D.x) + cx];
+	int top = chunkPos.z * m_chunkSize3D.z;
+	int bottom = top + m_chunkSize3D.z;
+
+	// density noise can move the surface by up to its amplitude in either direction
+	int margin = m_terrainMode == TerrainMode::Density ? int(std::ceil(m_densityAmplitude)) : 0;
+
+	if (bounds.minHeight >= bottom + margin) return ChunkFill::Empty;
+	if (bounds.maxHeight < top - margin) return ChunkFill::Solid;
+	return ChunkFill::Mixed;
+}
+
 Entity Scene_Play::player()
 {
 	auto& player = m_entityManager.getEntities("player");
@@ -91,7 +259,7 @@ void Scene_Play::spawnPlayer()
 	auto p = m_entityManager.addEntity(m_memoryPool, "player", "PlayerCharacter");
 	m_playerDied = false;
 	
-	auto& pAnimation = p.add<CAnimation>(m_memoryPool, m_game->assets().getAnimation("StormheadIdle"), true);
+	p.add<CAnimation>(m_memoryPool, m_game->assets().animationHandle("StormheadIdle"), m_currentFrame, true);
 
 	Grid3D gridPos(m_chunkSize3D.x, m_chunkSize3D.y, -m_chunkSize3D.z);
 	p.add<CTransform>(m_memoryPool, Utils::gridToIsometric(gridPos, m_gridCellSize));
@@ -99,18 +267,425 @@ void Scene_Play::spawnPlayer()
 	p.add<CInput>(m_memoryPool);
 }
 
-void Scene_Play::buildVertexArraysForChunks()
+void Scene_Play::markRegionDirty(const Grid3D& chunkPos)
 {
-	if (!m_chunkChanged) return;
-	m_chunkChanged = false;
+	m_dirtyRegions.insert(Utils::gridToChunkPos(CGridPosition(chunkPos), m_regionSize3D));
+}
 
-	for (Entity chunk : m_entityManager.getEntities("chunk"))
+template <typename F>
+void Scene_Play::forEachRegionSegment(const RegionBatch& region, F&& fn) const
+{
+	// visits the runs of tiles each member chunk has in the region's buckets, in draw order
+	auto& buckets = region.buckets;
+	for (int layer = 0; layer < buckets.numLayers; ++layer)
+	{
+		int z = buckets.bottom - layer;
+		size_t slab = size_t(layer / int(m_chunkSize3D.z));
+		for (int d = 0; d < buckets.numDepths; ++d)
+		{
+			int depth = buckets.maxDepth - d;
+			size_t bucket = buckets.bucket(z, depth);
+			for (size_t m = region.slabStarts[slab]; m < region.slabStarts[slab + 1]; ++m)
+			{
+				auto& member = region.members[m];
+				if (!member.visible) continue;
+
+				auto& chunkBuckets = member.tiles->buckets;
+				int localDepth = depth - int(member.origin.x + member.origin.y);
+				if (localDepth < 0 || localDepth > chunkBuckets.maxDepth) continue;
+
+				size_t local = chunkBuckets.bucket(z - int(member.origin.z), localDepth);
+				size_t begin = chunkBuckets.starts[local], end = chunkBuckets.starts[local + 1];
+				if (end > begin) fn(bucket, member, begin, end - begin);
+			}
+		}
+	}
+}
+
+void Scene_Play::buildRegionBatches()
+{
+	for (auto& regionPos : m_dirtyRegions)
+	{
+		auto& region = m_regionMap[regionPos];
+		region.members.clear();
+		region.slabStarts.clear();
+		region.numChunks = 0;
+		region.expanded = false;
+
+		// members are grouped by chunk layer, bottom first, since a region layer can only
+		// take tiles from the chunks in its own slab
+		Grid3D first(regionPos.x * m_regionSize3D.x, regionPos.y * m_regionSize3D.y,
+			regionPos.z * m_regionSize3D.z);
+		for (int cz = first.z + m_regionSize3D.z - 1; cz >= first.z; --cz)
+		{
+			region.slabStarts.push_back(region.members.size());
+			for (int cx = first.x + m_regionSize3D.x - 1; cx >= first.x; --cx)
+			{
+				for (int cy = first.y + m_regionSize3D.y - 1; cy >= first.y; --cy)
+				{
+					auto it = m_chunkMap.find(Grid3D(cx, cy, cz));
+					if (it == m_chunkMap.end()) continue;
+
+					Entity chunk = it->second;
+					auto& bounds = chunk.get<CScreenBounds>(m_memoryPool).rect;
+					if (region.numChunks == 0)
+					{
+						region.bounds = bounds;
+					}
+					else
+					{
+						sf::Vector2f lo(std::min(region.bounds.position.x, bounds.position.x),
+							std::min(region.bounds.position.y, bounds.position.y));
+						sf::Vector2f hi(std::max(region.bounds.position.x + region.bounds.size.x, bounds.position.x + bounds.size.x),
+							std::max(region.bounds.position.y + region.bounds.size.y, bounds.position.y + bounds.size.y));
+						region.bounds = sf::FloatRect(lo, hi - lo);
+					}
+
+					region.members.push_back({ &chunk.get<CChunkTiles>(m_memoryPool),
+						chunk.get<CGridPosition>(m_memoryPool).pos, bounds });
+					region.numChunks++;
+				}
+			}
+		}
+		region.slabStarts.push_back(region.members.size());
+
+		if (region.numChunks == 0)
+		{
+			releaseRegionMesh(region);
+			m_regionMap.erase(regionPos);
+			continue;
+		}
+
+		// members start out of view; the view test lays out whichever of them it lets through
+		region.minPos = Grid3D(first.x * m_chunkSize3D.x, first.y * m_chunkSize3D.y, first.z * m_chunkSize3D.z);
+		region.buckets.starts.clear();
+	}
+	m_dirtyRegions.clear();
+}
+
+void Scene_Play::layoutRegion(RegionBatch& region)
+{
+	// interleaves the visible members' buckets; the vertices are written on expansion
+	auto& buckets = region.buckets;
+	buckets.reset(region.minPos, Grid3D(m_regionSize3D.x * m_chunkSize3D.x, m_regionSize3D.y * m_chunkSize3D.y,
+		m_regionSize3D.z * m_chunkSize3D.z));
+	uint32_t numVertices = 0;
+	size_t nextBucket = 0;
+	forEachRegionSegment(region, [&](size_t bucket, const RegionMember&, size_t, size_t count)
+	{
+		// buckets skipped since the last segment are empty and start here as well
+		for (; nextBucket <= bucket; ++nextBucket) buckets.starts[nextBucket] = numVertices;
+		numVertices += uint32_t(count * 6);
+	});
+	for (; nextBucket < buckets.starts.size(); ++nextBucket) buckets.starts[nextBucket] = numVertices;
+}
+
+size_t Scene_Play::cullRegionMembers(RegionBatch& region, const sf::FloatRect& visibleArea)
+{
+	// per-chunk view test inside the region; a change in which members pass re-lays out the
+	// region, and its mesh is expanded again from just those chunks
+	bool regionInView = visibleArea.findIntersection(region.bounds).has_value();
+	size_t numVisible = 0;
+	bool changed = false;
+	for (auto& member : region.members)
 	{
-		auto& chunkTiles = chunk.get<CChunkTiles>(m_memoryPool);
-		if (!chunkTiles.changed) continue;
+		bool visible = regionInView && visibleArea.findIntersection(member.bounds).has_value();
+		changed |= visible != member.visible;
+		member.visible = visible;
+		numVisible += visible;
+	}
 
-		auto& cVa = chunk.add<CVertexArray>(m_memoryPool);
-		buildVertexArrayForChunk(cVa, chunkTiles, m_game->assets().getTexture("TexTiles"));
+	if (changed)
+	{
+		layoutRegion(region);
+		region.expanded = false;
+	}
+	return numVisible;
+}
+
+void Scene_Play::expandRegion(RegionBatch& region) const
+{
+	auto& vertices = region.mesh->vertices;
+	size_t numVertices = 0;
+	forEachRegionSegment(region, [&](size_t, const RegionMember& member, size_t first, size_t count)
+	{
+		writeTileVertices(&vertices[numVertices], &member.tiles->tiles[first], count, member.origin);
+		numVertices += count * 6;
+	});
+}
+
+std::shared_ptr<RegionMesh> Scene_Play::takeRegionMesh()
+{
+	if (m_meshPool.empty()) return std::make_shared<RegionMesh>();
+
+	auto mesh = std::move(m_meshPool.back());
+	m_meshPool.pop_back();
+	return mesh;
+}
+
+void Scene_Play::prepareRegionMesh(RegionBatch& region)
+{
+	// a mesh a render frame still holds is left to it and the region moves to another one
+	if (!region.mesh || region.mesh.use_count() > 1) region.mesh = takeRegionMesh();
+	region.mesh->buckets = region.buckets;
+	region.mesh->vertices.resize(region.buckets.starts.back());
+	region.expanded = true;
+}
+
+void Scene_Play::patchRegionMesh(const Grid3D& chunkPos, const CChunkTiles& chunkTiles, const Tile& tile, size_t tileIndex, int count)
+{
+	// keeps a region in step with one tile added to (count 1) or removed from (count -1) a
+	// member chunk, so a column edit moves a few vertices instead of re-expanding the region;
+	// a region waiting to be rebuilt picks the edit up from the chunk anyway
+	Grid3D regionPos = Utils::gridToChunkPos(CGridPosition(chunkPos), m_regionSize3D);
+	if (m_dirtyRegions.count(regionPos)) return;
+
+	auto it = m_regionMap.find(regionPos);
+	if (it == m_regionMap.end())
+	{
+		markRegionDirty(chunkPos);
+		return;
+	}
+	auto& region = it->second;
+	auto& buckets = region.buckets;
+	auto memberIt = std::find_if(region.members.begin(), region.members.end(),
+		[&](const RegionMember& m) { return m.tiles == &chunkTiles; });
+	if (memberIt == region.members.end())
+	{
+		markRegionDirty(chunkPos);
+		return;
+	}
+
+	// a chunk out of view is not in the layout; it is laid out afresh when it comes back
+	auto& member = *memberIt;
+	if (!member.visible) return;
+
+	// the tile's bucket in the region and how far into it the tile sits: past the runs the
+	// visible chunks before this one in the slab have there, then past its own neighbours
+	size_t m = size_t(memberIt - region.members.begin());
+	int z = int(member.origin.z) + tile.z;
+	int depth = int(member.origin.x + member.origin.y) + tile.depth();
+	size_t bucket = buckets.bucket(z, depth);
+	size_t slab = size_t((buckets.bottom - z) / int(m_chunkSize3D.z));
+
+	size_t offset = tileIndex - chunkTiles.buckets.starts[chunkTiles.buckets.bucket(tile)];
+	for (size_t k = region.slabStarts[slab]; k < m; ++k)
+	{
+		auto& other = region.members[k];
+		if (!other.visible) continue;
+
+		auto& otherBuckets = other.tiles->buckets;
+		int localDepth = depth - int(other.origin.x + other.origin.y);
+		if (localDepth < 0 || localDepth > otherBuckets.maxDepth) continue;
+
+		size_t local = otherBuckets.bucket(z - int(other.origin.z), localDepth);
+		offset += otherBuckets.starts[local + 1] - otherBuckets.starts[local];
+	}
+	size_t vertex = buckets.starts[bucket] + offset * 6;
+
+	for (size_t b = bucket + 1; b < buckets.starts.size(); ++b)
+	{
+		buckets.starts[b] += count * 6;
+	}
+	if (!region.expanded) return;
+
+	// a mesh a render frame is drawing is copied once and the region carries on with the copy
+	if (region.mesh.use_count() > 1)
+	{
+		auto mesh = takeRegionMesh();
+		mesh->vertices.assign(region.mesh->vertices.begin(), region.mesh->vertices.end());
+		m_retiredMeshes.push_back(std::move(region.mesh));
+		region.mesh = std::move(mesh);
+	}
+	auto& vertices = region.mesh->vertices;
+	if (count > 0)
+	{
+		vertices.insert(vertices.begin() + vertex, 6, sf::Vertex());
+		writeTileVertices(&vertices[vertex], &tile, 1, member.origin);
+	}
+	else
+	{
+		vertices.erase(vertices.begin() + vertex, vertices.begin() + vertex + 6);
+	}
+	region.mesh->buckets = buckets;
+}
+
+void Scene_Play::releaseRegionMesh(RegionBatch& region)
+{
+	region.expanded = false;
+	if (!region.mesh) return;
+
+	// keep the allocation around for the next region that scrolls into view; one a render
+	// frame is still drawing from is picked up once that frame lets go of it
+	if (region.mesh.use_count() > 1)
+		m_retiredMeshes.push_back(std::move(region.mesh));
+	else
+		recycleRegionMesh(std::move(region.mesh));
+	region.mesh.reset();
+}
+
+void Scene_Play::recycleRegionMesh(std::shared_ptr<RegionMesh> mesh)
+{
+	// the pool only needs to cover a full turnover of the visible set
+	if (m_meshPool.size() >= std::max<size_t>(m_visibleRegions.size(), 1)) return;
+
+	mesh->vertices.clear();
+	m_meshPool.push_back(std::move(mesh));
+}
+
+size_t Scene_Play::expandVisibleRegions()
+{
+	// meshes released while a frame still drew them are free again once it has let go
+	auto retired = std::partition(m_retiredMeshes.begin(), m_retiredMeshes.end(),
+		[](const std::shared_ptr<RegionMesh>& mesh) { return mesh.use_count() > 1; });
+	for (auto it = retired; it != m_retiredMeshes.end(); ++it) recycleRegionMesh(std::move(*it));
+	m_retiredMeshes.erase(retired, m_retiredMeshes.end());
+
+	// give every visible region without a current mesh a buffer, then fill them in parallel
+	m_expandQueue.clear();
+	for (auto* region : m_visibleRegions)
+	{
+		region->lastVisible = m_currentFrame;
+		if (region->expanded) continue;
+
+		prepareRegionMesh(*region);
+		m_expandQueue.push_back(region);
+	}
+	expandRegions(m_expandQueue);
+	size_t numExpanded = m_expandQueue.size();
+
+	// only the visible regions keep a mesh; everything else goes back to the pool, so the
+	// resident vertex memory follows the view rather than the load radius
+	for (auto& [regionPos, region] : m_regionMap)
+	{
+		if (region.mesh && region.lastVisible != m_currentFrame) releaseRegionMesh(region);
+	}
+	return numExpanded;
+}
+
+size_t Scene_Play::residentMeshBytes() const
+{
+	// every region vertex buffer still allocated, whether in use, pooled or waiting on a frame
+	size_t numVertices = 0;
+	for (auto& [regionPos, region] : m_regionMap)
+	{
+		if (region.mesh) numVertices += region.mesh->vertices.capacity();
+	}
+	for (auto& mesh : m_meshPool) numVertices += mesh->vertices.capacity();
+	for (auto& mesh : m_retiredMeshes) numVertices += mesh->vertices.capacity();
+	return numVertices * sizeof(sf::Vertex);
+}
+
+int Scene_Play::lodBlockSize() const
+{
+	// columns per impostor block for the current view scale; 1 means full detail
+	float zoom = m_cameraView.getSize().x / float(width());
+	if (zoom < 3.0f) return 1;
+	if (zoom < 8.0f) return 4;
+	return 8;
+}
+
+void Scene_Play::buildImpostors()
+{
+	int block = lodBlockSize();
+	if (block != m_lodBlock)
+	{
+		m_impostors.clear();
+		m_lodBlock = block;
+	}
+	if (m_lodBlock == 1) return;
+
+	// impostors come straight from the heightmap, so they can cover the whole view
+	// regardless of the chunk load radius; only patches that come into view are built
+	sf::FloatRect visibleArea = Utils::visibleArea(m_cameraView);
+	int numX = (int(m_gridSize3D.x) + m_impostorPatchSize - 1) / m_impostorPatchSize;
+	int numY = (int(m_gridSize3D.y) + m_impostorPatchSize - 1) / m_impostorPatchSize;
+	for (int px = 0; px < numX; ++px)
+	{
+		for (int py = 0; py < numY; ++py)
+		{
+			Grid3D patchPos(px, py, 0);
+			if (m_impostors.contains(patchPos)) continue;
+
+			sf::FloatRect bounds = impostorPatchBounds(patchPos);
+			if (!visibleArea.findIntersection(bounds)) continue;
+
+			auto& patch = m_impostors[patchPos];
+			patch.bounds = bounds;
+			buildImpostorPatch(patchPos, patch);
+		}
+	}
+}
+
+sf::FloatRect Scene_Play::impostorPatchBounds(const Grid3D& patchPos) const
+{
+	// padded by one block since the scaled cubes reach past the column box
+	float size = float(m_impostorPatchSize), pad = float(m_lodBlock);
+	Grid3D minPos(patchPos.x * size - pad, patchPos.y * size - pad, -m_gridSize3D.z - pad);
+	Grid3D maxPos((patchPos.x + 1) * size + pad, (patchPos.y + 1) * size + pad, pad);
+	return Utils::isometricBounds(minPos, maxPos, m_gridCellSize);
+}
+
+void Scene_Play::buildImpostorPatch(const Grid3D& patchPos, ImpostorPatch& patch) const
+{
+	int block = m_lodBlock;
+	int blocksPerPatch = m_impostorPatchSize / block;
+	int firstX = int(patchPos.x) * blocksPerPatch, firstY = int(patchPos.y) * blocksPerPatch;
+
+	// a block stands at the highest surface among its columns
+	auto blockTop = [&](int bx, int by)
+	{
+		int top = INT_MAX;
+		for (int x = bx * block; x < (bx + 1) * block; ++x)
+		{
+			for (int y = by * block; y < (by + 1) * block; ++y)
+			{
+				top = std::min(top, columnHeight(x, y));
+			}
+		}
+		return top;
+	};
+
+	// built into a fresh buffer since the previous one may still be in a render frame
+	float half = float(block - 1) / 2.0f;
+	auto vertices = std::make_shared<std::vector<sf::Vertex>>();
+	for (int bx = firstX + blocksPerPatch - 1; bx >= firstX; --bx)
+	{
+		for (int by = firstY + blocksPerPatch - 1; by >= firstY; --by)
+		{
+			int top = blockTop(bx, by);
+			if (top == INT_MAX) continue;
+
+			// same exposure rule as exposedEnd, one level of the coarse grid up
+			int end = std::max({ top + block, blockTop(bx - 1, by), blockTop(bx, by - 1) });
+			if (end == INT_MAX) end = top + block;
+			int numCubes = (end - top + block - 1) / block;
+
+			// bottom cube first so each column is drawn back to front
+			for (int c = numCubes - 1; c >= 0; --c)
+			{
+				int z = top + c * block;
+				Grid3D center(bx * block + half, by * block + half, z + half);
+				sf::Vector2f pos = Utils::gridToIsometric(center, m_gridCellSize);
+				auto& uvs = m_tileUVs[size_t(tileMaterial(z))];
+				for (size_t v = 0; v < 6; ++v)
+				{
+					vertices->push_back({ pos + m_tileCorners[v] * float(block), sf::Color::White, uvs[v] });
+				}
+			}
+		}
+	}
+	patch.vertices = std::move(vertices);
+}
+
+void Scene_Play::invalidateImpostors(int x, int y)
+{
+	// an edited column changes its own block and the exposure of the blocks in front of it
+	const int columns[3][2] = { { x, y }, { x + m_lodBlock, y }, { x, y + m_lodBlock } };
+	for (auto& column : columns)
+	{
+		m_impostors.erase(Grid3D(Utils::divFloor(column[0], m_impostorPatchSize),
+			Utils::divFloor(column[1], m_impostorPatchSize), 0));
 	}
 }
 
@@ -124,11 +699,18 @@ void Scene_Play::spawnChunks()
 			for (int dz = -m_loadRadius; dz <= m_loadRadius; ++dz)
 			{
 				Grid3D chunkPos = playerChunkPos + Grid3D(dx, dy, dz);
-				if (m_chunkMap.contains(chunkPos)) continue;
+				if (m_chunkMap.contains(chunkPos) || m_skippedChunks.contains(chunkPos)) continue;
+
+				ChunkFill fill = classifyChunk(chunkPos);
+				if (fill != ChunkFill::Mixed)
+				{
+					m_skippedChunks.insert({ chunkPos, fill });
+					continue;
+				}
 
 				Entity chunk = spawnChunk(chunkPos);
 				m_chunkMap.insert({ chunkPos, chunk });
-				m_chunkChanged = true;
+				markRegionDirty(chunkPos);
 			}
 		}
 	}
@@ -146,16 +728,38 @@ void Scene_Play::despawnChunks()
 
 		if (!(dx > m_loadRadius || dy > m_loadRadius || dz > m_loadRadius)) continue;
 
-		auto& tileChunk = chunk.get<CChunkTiles>(m_memoryPool);
-		for (Entity tile : tileChunk.tiles)
-		{
-			auto& tilePos = tile.get<CGridPosition>(m_memoryPool);
-			tile.destroy(m_memoryPool);
-			m_tileSet.erase(tilePos.pos);
-		}
-		chunk.destroy(m_memoryPool);
-		m_chunkMap.erase(chunkPos);
+		despawnChunk(chunk);
+	}
+
+	for (auto it = m_skippedChunks.begin(); it != m_skippedChunks.end();)
+	{
+		auto& chunkPos = it->first;
+		int dx = std::abs(chunkPos.x - playerChunkPos.x);
+		int dy = std::abs(chunkPos.y - playerChunkPos.y);
+		int dz = std::abs(chunkPos.z - playerChunkPos.z);
+
+		if (dx > m_loadRadius || dy > m_loadRadius || dz > m_loadRadius)
+			it = m_skippedChunks.erase(it);
+		else
+			++it;
+	}
+}
+
+void Scene_Play::despawnChunk(Entity chunk)
+{
+	auto chunkPos = Utils::gridToChunkPos(chunk.get<CGridPosition>(m_memoryPool), m_chunkSize3D);
+	chunk.destroy(m_memoryPool);
+	m_chunkMap.erase(chunkPos);
+	markRegionDirty(chunkPos);
+}
+
+void Scene_Play::despawnAllChunks()
+{
+	for (Entity chunk : m_entityManager.getEntities("chunk"))
+	{
+		if (chunk.isActive(m_memoryPool)) despawnChunk(chunk);
 	}
+	m_skippedChunks.clear();
 }
 
 Entity Scene_Play::spawnChunk(const Grid3D& chunkPos)
@@ -168,52 +772,211 @@ Entity Scene_Play::spawnChunk(const Grid3D& chunkPos)
 
 	chunk.add<CTransform>(m_memoryPool, Utils::gridToIsometric(gridPos, m_gridCellSize));
 	auto& chunkGridPos = chunk.add<CGridPosition>(m_memoryPool, gridPos);
+	chunk.add<CScreenBounds>(m_memoryPool, Utils::isometricBounds(gridPos,
+		gridPos + m_chunkSize3D - Grid3D(1, 1, 1), m_gridCellSize));
 	auto& chunkTiles = chunk.add<CChunkTiles>(m_memoryPool);
 
 	spawnTilesFromChunk(chunkGridPos, chunkTiles);
-	chunkTiles.changed = true;
+	bucketTiles(chunkTiles);
 	return chunk;
 }
 
+void Scene_Play::bucketTiles(CChunkTiles& chunkTiles)
+{
+	// counting sort on (z, x + y); the generators emit x, y, z descending and the sort is
+	// stable, so ties come out in the order Tile::drawsBefore expects
+	auto& buckets = chunkTiles.buckets;
+	buckets.reset(Grid3D(0, 0, 0), m_chunkSize3D);
+
+	auto& starts = buckets.starts;
+	for (auto& tile : chunkTiles.tiles)
+	{
+		starts[buckets.bucket(tile) + 1]++;
+	}
+	for (size_t b = 0; b < buckets.numBuckets(); ++b)
+	{
+		starts[b + 1] += starts[b];
+	}
+
+	m_tileScratch.resize(chunkTiles.tiles.size());
+	std::vector<uint32_t> next(starts.begin(), starts.end() - 1);
+	for (auto& tile : chunkTiles.tiles)
+	{
+		m_tileScratch[next[buckets.bucket(tile)]++] = tile;
+	}
+
+	// the old buffer becomes the next chunk's scratch space
+	chunkTiles.tiles.swap(m_tileScratch);
+}
+
 void Scene_Play::spawnTilesFromChunk(CGridPosition& chunkGridPos, CChunkTiles& chunkTiles)
+{
+	if (m_terrainMode == TerrainMode::Density)
+		spawnTilesFromDensity(chunkGridPos, chunkTiles);
+	else
+		spawnTilesFromHeightMap(chunkGridPos, chunkTiles);
+}
+
+void Scene_Play::spawnTilesFromHeightMap(CGridPosition& chunkGridPos, CChunkTiles& chunkTiles)
 {
 	Grid3D& cPos = chunkGridPos.pos;
 	int startX = cPos.x, endX = cPos.x + m_chunkSize3D.x;
 	int startY = cPos.y, endY = cPos.y + m_chunkSize3D.y;
 
-	for (int x = startX; x < endX; ++x)
+	// spawn back to front so the tile list is already in draw order
+	for (int x = endX - 1; x >= startX; --x)
 	{
 		if (x < 0 || x >= m_gridSize3D.x) continue;
-		for (int y = startY; y < endY; ++y)
+		for (int y = endY - 1; y >= startY; --y)
 		{
 			if (y < 0 || y >= m_gridSize3D.y) continue;
 
-			int flatIndex = y * m_gridSize3D.x + x;
-			int columnHeight = m_heightMap[flatIndex];
-			int startZ = std::max(static_cast<int>(cPos.z), columnHeight);
-			int endZ = cPos.z + m_chunkSize3D.z;
+			int startZ = std::max(static_cast<int>(cPos.z), columnHeight(x, y));
+			int endZ = std::min(static_cast<int>(cPos.z + m_chunkSize3D.z), exposedEnd(x, y));
+
+			for (int z = endZ - 1; z >= startZ; --z)
+			{
+				chunkTiles.tiles.push_back(makeTile(cPos, x, y, z));
+			}
+		}
+	}
+}
+
+void Scene_Play::spawnTilesFromDensity(CGridPosition& chunkGridPos, CChunkTiles& chunkTiles)
+{
+	Grid3D& cPos = chunkGridPos.pos;
 
-			for (int z = startZ; z < endZ; ++z)
+	// sample one extra voxel on the -x/-y/-z sides so faces on the chunk border can be tested
+	NoiseBlock block;
+	block.x = cPos.x - 1;
+	block.y = cPos.y - 1;
+	block.z = cPos.z - 1;
+	block.nx = m_chunkSize3D.x + 1;
+	block.ny = m_chunkSize3D.y + 1;
+	block.nz = m_chunkSize3D.z + 1;
+
+	auto& density = m_densityScratch;
+	if (m_coarseDensity)
+		PerlinNoise::GenerateCoarseDensityNoise(density, block, m_densityStep,
+			m_densityCell, m_densityOctaves, m_terrainSeed);
+	else
+		PerlinNoise::GenerateDensityNoise(density, block,
+			m_densityCell, m_densityOctaves, m_terrainSeed);
+
+	// bend the heightfield surface by the noise: anything with density >= 0 is solid,
+	// which carves overhangs, arches and shallow caves within the amplitude band
+	for (int k = 0; k < block.nz; ++k)
+	{
+		int z = block.z + k;
+		for (int j = 0; j < block.ny; ++j)
+		{
+			int y = block.y + j;
+			float* row = &density[(size_t(k) * block.ny + j) * block.nx];
+			for (int i = 0; i < block.nx; ++i)
 			{
-				Grid3D gridPos(x, y, z);
+				int surface = columnHeight(block.x + i, y);
+				row[i] = surface == INT_MAX ? -1.0f
+					: float(z - surface) + m_densityAmplitude * row[i];
+			}
+		}
+	}
 
-				auto [it, inserted] = m_tileSet.insert(gridPos);
-				if (!inserted) continue;
+	auto solid = [&](int i, int j, int k)
+	{
+		return density[(size_t(k) * block.ny + j) * block.nx + i] >= 0.0f;
+	};
 
-				bool surrounded =
-					m_tileSet.contains(gridPos - Grid3D(1, 0, 0)) &&
-					m_tileSet.contains(gridPos - Grid3D(0, 1, 0)) &&
-					m_tileSet.contains(gridPos - Grid3D(0, 0, 1));
-				if (surrounded) continue;
+	for (int i = block.nx - 1; i >= 1; --i)
+	{
+		for (int j = block.ny - 1; j >= 1; --j)
+		{
+			for (int k = block.nz - 1; k >= 1; --k)
+			{
+				if (!solid(i, j, k)) continue;
+				if (solid(i - 1, j, k) && solid(i, j - 1, k) && solid(i, j, k - 1)) continue;
 
-				chunkTiles.tiles.emplace_back(spawnTile(gridPos));
+				chunkTiles.tiles.push_back(makeTile(cPos, block.x + i, block.y + j, block.z + k));
 			}
 		}
 	}
 }
 
+void Scene_Play::benchmarkChunkGeneration()
+{
+	struct TerrainPath
+	{
+		const char* name;
+		TerrainMode mode;
+		bool coarse;
+	};
+	const TerrainPath paths[] = {
+		{ "heightmap", TerrainMode::HeightMap, false },
+		{ "density", TerrainMode::Density, false },
+		{ "density (coarse)", TerrainMode::Density, true }
+	};
+
+	TerrainMode mode = m_terrainMode;
+	bool coarse = m_coarseDensity;
+	auto playerChunkPos = Utils::gridToChunkPos(player().get<CGridPosition>(m_memoryPool), m_chunkSize3D);
+
+	// generate every non-trivial chunk of the load cube once per path and throw the tiles away
+	for (auto& path : paths)
+	{
+		m_terrainMode = path.mode;
+		m_coarseDensity = path.coarse;
+
+		size_t numChunks = 0, numTiles = 0;
+		sf::Clock clock;
+		for (int dx = -m_loadRadius; dx <= m_loadRadius; ++dx)
+		{
+			for (int dy = -m_loadRadius; dy <= m_loadRadius; ++dy)
+			{
+				for (int dz = -m_loadRadius; dz <= m_loadRadius; ++dz)
+				{
+					Grid3D chunkPos = playerChunkPos + Grid3D(dx, dy, dz);
+					if (classifyChunk(chunkPos) != ChunkFill::Mixed) continue;
+
+					CGridPosition chunkGridPos(Grid3D(chunkPos.x * m_chunkSize3D.x,
+						chunkPos.y * m_chunkSize3D.y, chunkPos.z * m_chunkSize3D.z));
+					CChunkTiles chunkTiles;
+					spawnTilesFromChunk(chunkGridPos, chunkTiles);
+
+					numChunks++;
+					numTiles += chunkTiles.tiles.size();
+				}
+			}
+		}
+
+		float ms = clock.getElapsedTime().asMicroseconds() / 1000.0f;
+		std::cout << "[benchmark] " << path.name << ": " << numChunks << " chunks, "
+			<< numTiles << " tiles, " << ms << " ms total, "
+			<< ms / std::max<size_t>(numChunks, 1) << " ms/chunk" << std::endl;
+	}
+
+	m_terrainMode = mode;
+	m_coarseDensity = coarse;
+
+	// expand every loaded region from scratch to measure meshing throughput
+	buildRegionBatches();
+	size_t numTiles = 0;
+	m_expandQueue.clear();
+	for (auto& [regionPos, region] : m_regionMap)
+	{
+		prepareRegionMesh(region);
+		numTiles += region.mesh->vertices.size() / 6;
+		m_expandQueue.push_back(&region);
+	}
+
+	sf::Clock clock;
+	expandRegions(m_expandQueue);
+	float ms = clock.getElapsedTime().asMicroseconds() / 1000.0f;
+	std::cout << "[benchmark] meshing: " << numTiles << " tiles, " << ms << " ms, "
+		<< numTiles / std::max(ms, 0.001f) / 1000.0f << " Mtiles/s" << std::endl;
+	std::cout << "[benchmark] packed tiles " << numTiles * sizeof(Tile) / 1024 << " KB, expanded "
+		<< numTiles * 6 * sizeof(sf::Vertex) / 1024 << " KB" << std::endl;
+}
 
-Entity Scene_Play::spawnTile(Grid3D& chunkPos)
+TileMaterial Scene_Play::tileMaterial(int z) const
 {
 	const static int m_grassLevel = 22;
 	const static int m_snowLevel = 36;
@@ -221,44 +984,248 @@ Entity Scene_Play::spawnTile(Grid3D& chunkPos)
 	int grassLevel = -m_grassLevel;
 	int snowLevel = -m_snowLevel;
 
-	sf::Vector2i tileTexPos;
-	if (chunkPos.z >= waterLevel) tileTexPos = sf::Vector2i(1, 2);
-	else if (waterLevel > chunkPos.z && chunkPos.z >= grassLevel) tileTexPos = sf::Vector2i(0, 6);
-	else if (grassLevel > chunkPos.z && chunkPos.z >= snowLevel) tileTexPos = sf::Vector2i(0, 0);
-	else if (snowLevel > chunkPos.z) tileTexPos = sf::Vector2i(0, 3);
+	TileMaterial material = TileMaterial::Snow;
+	if (z >= waterLevel) material = TileMaterial::Water;
+	else if (z >= grassLevel) material = TileMaterial::Sand;
+	else if (z >= snowLevel) material = TileMaterial::Grass;
 
-	tileTexPos.x *= m_gridCellSize.x;
-	tileTexPos.y *= m_gridCellSize.y;
+	return material;
+}
 
-	auto tile = m_entityManager.addEntity(m_memoryPool, "tile", "Tile");
-	
-	tile.add<CTileRenderInfo>(m_memoryPool, Utils::gridToIsometric(chunkPos, m_gridCellSize),
-		sf::IntRect(tileTexPos, sf::Vector2i(m_gridCellSize)));
-	tile.add<CGridPosition>(m_memoryPool, chunkPos);
+Tile Scene_Play::makeTile(const Grid3D& origin, int x, int y, int z) const
+{
+	return Tile(x - int(origin.x), y - int(origin.y), z - int(origin.z), tileMaterial(z));
+}
+
+void Scene_Play::buildTileMeshTables()
+{
+	// cell of each material in the tile sheet
+	const sf::Vector2i materialCells[] = {
+		{ 1, 2 }, // Water
+		{ 0, 6 }, // Sand
+		{ 0, 0 }, // Grass
+		{ 0, 3 }  // Snow
+	};
+
+	// two triangles per tile: top-left, top-right, bottom-right, bottom-right, bottom-left, top-left
+	const sf::Vector2f corners[] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 1, 1 }, { 0, 1 }, { 0, 0 } };
+	sf::Vector2f cell = m_gridCellSize;
+
+	// the tile sheet lives on a shared atlas page, so uvs are offset to where it landed
+	auto& atlasRegion = m_game->assets().getAtlasRegion("TexTiles");
+	m_tileTexture = &m_game->assets().getAtlasPage(atlasRegion.page);
+	sf::Vector2f atlasOffset(atlasRegion.rect.position);
+
+	for (size_t v = 0; v < 6; ++v)
+	{
+		m_tileCorners[v] = sf::Vector2f(corners[v].x * cell.x, corners[v].y * cell.y) - cell / 2.f;
+	}
+
+	for (size_t m = 0; m < size_t(TileMaterial::Count); ++m)
+	{
+		sf::Vector2f texPos = atlasOffset + sf::Vector2f(materialCells[m].x * cell.x, materialCells[m].y * cell.y);
+		for (size_t v = 0; v < 6; ++v)
+		{
+			m_tileUVs[m][v] = texPos + sf::Vector2f(corners[v].x * cell.x, corners[v].y * cell.y);
+		}
+	}
+}
+
+void Scene_Play::digColumn(int x, int y)
+{
+	// surfaces stay inside the world's z range, [-size.z, 0), so pickColumn can still find them
+	int height = columnHeight(x, y);
+	if (height == INT_MAX) return;
+	setColumnHeight(x, y, std::min(height + 1, -1));
+}
 
-	return tile;
+void Scene_Play::raiseColumn(int x, int y)
+{
+	int height = columnHeight(x, y);
+	if (height == INT_MAX) return;
+	setColumnHeight(x, y, std::max(height - 1, -int(m_gridSize3D.z)));
+}
+
+void Scene_Play::setColumnHeight(int x, int y, int height)
+{
+	if (x < 0 || x >= m_gridSize3D.x || y < 0 || y >= m_gridSize3D.y) return;
+
+	// exposure of a column depends on its own surface and its -x/-y neighbours,
+	// so the edited column and the two columns in front of it are the only ones affected
+	const int columns[3][2] = { { x, y }, { x + 1, y }, { x, y + 1 } };
+	int oldStart[3], oldEnd[3];
+	for (int c = 0; c < 3; ++c)
+	{
+		oldStart[c] = columnHeight(columns[c][0], columns[c][1]);
+		oldEnd[c] = exposedEnd(columns[c][0], columns[c][1]);
+	}
+
+	int oldHeight = columnHeight(x, y);
+	m_heightMap[y * int(m_gridSize3D.x) + x] = height;
+	invalidateImpostors(x, y);
+
+	int cw = int(m_chunkSize3D.x), ch = int(m_chunkSize3D.y), cd = int(m_chunkSize3D.z);
+	for (auto& column : columns)
+	{
+		computeChunkColumnBounds(int(Utils::divFloor(column[0], cw)), int(Utils::divFloor(column[1], ch)));
+	}
+
+	auto playerChunkPos = Utils::gridToChunkPos(player().get<CGridPosition>(m_memoryPool), m_chunkSize3D);
+	int loadedTop = (int(playerChunkPos.z) - m_loadRadius) * cd;
+	int loadedBottom = (int(playerChunkPos.z) + m_loadRadius + 1) * cd;
+
+	if (m_terrainMode == TerrainMode::Density)
+	{
+		// density tiles depend on the noise around the surface, so respawn the chunks
+		// whose amplitude band the edit touched instead of diffing exposure
+		int margin = int(std::ceil(m_densityAmplitude)) + 1;
+		int top = int(Utils::divFloor(std::min(oldHeight, height) - margin, cd));
+		int bottom = int(Utils::divFloor(std::max(oldHeight, height) + margin, cd));
+		for (auto& column : columns)
+		{
+			for (int cz = top; cz <= bottom; ++cz)
+			{
+				Grid3D chunkPos(Utils::divFloor(column[0], cw), Utils::divFloor(column[1], ch), cz);
+				m_skippedChunks.erase(chunkPos);
+				auto it = m_chunkMap.find(chunkPos);
+				if (it != m_chunkMap.end()) despawnChunk(it->second);
+			}
+		}
+		return;
+	}
+
+	for (int c = 0; c < 3; ++c)
+	{
+		int cx = columns[c][0], cy = columns[c][1];
+		int newStart = columnHeight(cx, cy);
+		int newEnd = exposedEnd(cx, cy);
+		if (newStart == INT_MAX) continue;
+
+		// only the voxels whose visibility flipped need a tile added or removed
+		int from = std::max(std::min(oldStart[c], newStart), loadedTop);
+		int to = std::min(std::max(oldEnd[c], newEnd), loadedBottom);
+		for (int z = from; z < to; ++z)
+		{
+			bool wasVisible = z >= oldStart[c] && z < oldEnd[c];
+			bool isVisible = z >= newStart && z < newEnd;
+			if (wasVisible == isVisible) continue;
+
+			if (isVisible)
+				addTerrainTile(Grid3D(cx, cy, z));
+			else
+				removeTerrainTile(Grid3D(cx, cy, z));
+		}
+	}
+}
+
+bool Scene_Play::pickColumn(const Vec2f& worldPos, Grid3D& columnTop) const
+{
+	// walk down the view ray one level at a time and stop at the first top face it lands on
+	for (int z = -int(m_gridSize3D.z); z < 0; ++z)
+	{
+		Vec2f grid = Utils::isometricToGrid(worldPos.x, worldPos.y, z, m_gridCellSize);
+		int x = int(std::floor(grid.x)), y = int(std::floor(grid.y));
+		int surface = columnHeight(x, y);
+		if (surface == INT_MAX || surface > z) continue;
+
+		columnTop = Grid3D(x, y, surface);
+		return true;
+	}
+	return false;
+}
+
+void Scene_Play::addTerrainTile(const Grid3D& gridPos)
+{
+	auto chunkPos = Utils::gridToChunkPos(CGridPosition(gridPos), m_chunkSize3D);
+
+	auto skipped = m_skippedChunks.find(chunkPos);
+	if (skipped != m_skippedChunks.end())
+	{
+		// a buried chunk got dug into; let spawnChunks generate it on the next tick
+		if (classifyChunk(chunkPos) == ChunkFill::Mixed) m_skippedChunks.erase(skipped);
+		return;
+	}
+
+	auto it = m_chunkMap.find(chunkPos);
+	if (it == m_chunkMap.end()) return;
+
+	Entity chunk = it->second;
+	auto& tiles = chunk.get<CChunkTiles>(m_memoryPool).tiles;
+	Tile tile = makeTile(chunk.get<CGridPosition>(m_memoryPool).pos, gridPos.x, gridPos.y, gridPos.z);
+	auto slot = std::lower_bound(tiles.begin(), tiles.end(), tile,
+		[](const Tile& a, const Tile& b) { return a.drawsBefore(b); });
+	if (slot != tiles.end() && slot->samePos(tile)) return;
+
+	size_t tileIndex = size_t(slot - tiles.begin());
+	tiles.insert(slot, tile);
+	shiftTileBuckets(chunk.get<CChunkTiles>(m_memoryPool), tile, 1);
+	patchRegionMesh(chunkPos, chunk.get<CChunkTiles>(m_memoryPool), tile, tileIndex, 1);
+}
+
+void Scene_Play::shiftTileBuckets(CChunkTiles& chunkTiles, const Tile& tile, int count)
+{
+	// every bucket after the tile's own starts count tiles later
+	auto& starts = chunkTiles.buckets.starts;
+	for (size_t b = chunkTiles.buckets.bucket(tile) + 1; b < starts.size(); ++b)
+	{
+		starts[b] += count;
+	}
+}
+
+void Scene_Play::removeTerrainTile(const Grid3D& gridPos)
+{
+	auto chunkPos = Utils::gridToChunkPos(CGridPosition(gridPos), m_chunkSize3D);
+	auto it = m_chunkMap.find(chunkPos);
+	if (it == m_chunkMap.end()) return;
+
+	Entity chunk = it->second;
+	auto& tiles = chunk.get<CChunkTiles>(m_memoryPool).tiles;
+	Tile tile = makeTile(chunk.get<CGridPosition>(m_memoryPool).pos, gridPos.x, gridPos.y, gridPos.z);
+	auto slot = std::lower_bound(tiles.begin(), tiles.end(), tile,
+		[](const Tile& a, const Tile& b) { return a.drawsBefore(b); });
+	if (slot == tiles.end() || !slot->samePos(tile)) return;
+
+	size_t tileIndex = size_t(slot - tiles.begin());
+	tiles.erase(slot);
+	shiftTileBuckets(chunk.get<CChunkTiles>(m_memoryPool), tile, -1);
+	patchRegionMesh(chunkPos, chunk.get<CChunkTiles>(m_memoryPool), tile, tileIndex, -1);
 }
 
 void Scene_Play::update()
 {
 	if (!m_paused)
 	{
-		spawnChunks();
-		despawnChunks();
+		// in a fast-forward batch only the last tick streams chunks and places the camera,
+		// since nothing in between is drawn
+		if (m_lastTick)
+		{
+			spawnChunks();
+			despawnChunks();
+		}
 		m_entityManager.update(m_memoryPool);
-		buildVertexArraysForChunks();
 		sMovement();
 		sCollision();
-		sCamera();
-		sAnimation();
+		if (m_lastTick)
+		{
+			sCamera();
+			buildImpostors();
+		}
 	}
 
 	if (m_playerDied)
 	{
-		m_game->changeScene("MENU", std::make_shared<Scene_Menu>(m_game));
+		returnToMenu();
 	}
 }
 
+void Scene_Play::returnToMenu()
+{
+	m_game->changeScene("MENU", [game = m_game]() -> std::shared_ptr<Scene>
+	{
+		return std::make_shared<Scene_Menu>(game);
+	});
+}
+
 void Scene_Play::sMovement()
 {
 	static const float moveStep = 0.5f;
@@ -277,9 +1244,11 @@ void Scene_Play::sMovement()
 	if (input.down) { delta.z += moveStep; } // UP
 	if (input.up) { delta.z -= moveStep; } // DOWN
 
+	// prevPos is the previous tick's position even when standing still, so rendering
+	// never interpolates towards a stale step
+	transform.prevPos = transform.pos;
 	if (!(delta == Grid3D{ 0, 0, 0 })) {
 		grid.pos += delta;
-		transform.prevPos = transform.pos;
 		transform.pos = Utils::gridToIsometric(grid.pos, m_gridCellSize);
 	}
 }
@@ -304,75 +1273,15 @@ void Scene_Play::sSelect()
 	
 }
 
-void Scene_Play::sDoAction(const Action& action)
-{
-	auto& pInput = player().get<CInput>(m_memoryPool);
-	if (action.m_type == "START")
-	{
-		if (action.m_name == "LEFT")
-			pInput.left = true;
-		else if (action.m_name == "RIGHT")
-			pInput.right = true;
-		else if (action.m_name == "UP")
-			pInput.up = true;
-		else if (action.m_name == "DOWN")
-			pInput.down = true;
-		if (action.m_name == "FORWARD")
-			pInput.forward = true;
-		else if (action.m_name == "BACKWARD")
-			pInput.backward = true;
-		else if (action.m_name == "ESCAPE")
-		{
-			m_game->changeScene("MENU", std::make_shared<Scene_Menu>(m_game));
-		}	
-		else if (action.m_name == "LEFT_CLICK")
-		{
-			m_mousePos = m_game->window().mapPixelToCoords(action.m_mousePos);
-		}
-		else if (action.m_name == "RIGHT_CLICK")
-		{
-			m_mousePos = m_game->window().mapPixelToCoords(action.m_mousePos);
-		}
-		else if (action.m_name == "MOUSE_MOVE")
-		{
-			m_mousePos = m_game->window().mapPixelToCoords(action.m_mousePos);
-		}
-		else if (action.m_name == "MOUSE_SCROLL")
-		{
-			float zoomFactor = action.m_mouseScrollDelta > 0 ? 0.9f : 1.1f;
-			m_cameraView.zoom(zoomFactor);
-			m_game->window().setView(m_cameraView);
-		}
-	}
-	else if (action.m_type == "END")
-	{
-		if (action.m_name == "LEFT")
-			pInput.left = false;
-		else if (action.m_name == "RIGHT")
-			pInput.right = false;
-		if (action.m_name == "UP")
-			pInput.up = false;
-		else if (action.m_name == "DOWN")
-			pInput.down = false;
-		if (action.m_name == "FORWARD")
-			pInput.forward = false;
-		else if (action.m_name == "BACKWARD")
-			pInput.backward = false;
-	}
-}
-
-void Scene_Play::sAnimation()
-{
-	auto& transform = player().get<CTransform>(m_memoryPool);
-	auto& animation = player().get<CAnimation>(m_memoryPool).animation;
-	animation.m_sprite.setPosition(transform.pos);
-}
-
 void Scene_Play::sCamera()
 {
 	auto& pTransform = player().get<CTransform>(m_memoryPool);
 	m_cameraView.setCenter(pTransform.pos);
-	m_game->window().setView(m_cameraView);
+}
+
+Vec2f Scene_Play::interpolatedPos(const CTransform& transform) const
+{
+	return transform.prevPos + (transform.pos - transform.prevPos) * m_interpolation;
 }
 
 void Scene_Play::onEnd()
@@ -382,7 +1291,9 @@ void Scene_Play::onEnd()
 
 void Scene_Play::onExitScene()
 {
-
+	// the scene is kept for later, so nothing held down should still be held on return
+	player().get<CInput>(m_memoryPool) = CInput();
+	m_pendingActions.clear();
 }
 
 void Scene_Play::onEnterScene()
@@ -396,82 +1307,211 @@ void Scene_Play::sGui()
 
 }
 
+void Scene_Play::prepareFrame()
+{
+	// runs on the simulation thread after the frame's ticks; the back frame is not being
+	// drawn, and the meshes it picks up are never written again while it holds them
+	auto& frame = m_frames[1 - m_frontFrame];
+	frame.regions.clear();
+	frame.impostors.clear();
+	frame.actors.clear();
+	frame.stats = RenderStats();
+
+	// actors and the camera are placed between the last two ticks
+	m_cameraView.setCenter(interpolatedPos(player().get<CTransform>(m_memoryPool)));
+	frame.view = m_cameraView;
+	sf::FloatRect visibleArea = Utils::visibleArea(m_cameraView);
+
+	// regions are drawn back to front, each with only its chunks that pass the view test
+	buildRegionBatches();
+	m_visibleRegions.clear();
+	for (auto it = m_regionMap.rbegin(); m_lodBlock == 1 && it != m_regionMap.rend(); ++it)
+	{
+		auto& region = it->second;
+		size_t numVisible = cullRegionMembers(region, visibleArea);
+		frame.stats.chunksCulled += region.numChunks - numVisible;
+		if (numVisible == 0) continue;
+
+		m_visibleRegions.push_back(&region);
+		frame.stats.chunksDrawn += numVisible;
+	}
+	frame.stats.meshesExpanded = expandVisibleRegions();
+	for (auto* region : m_visibleRegions) frame.regions.push_back(region->mesh);
+	frame.stats.meshBytes = residentMeshBytes();
+
+	// zoomed out, the impostors replace the chunk meshes and actors just go on top
+	for (auto it = m_impostors.rbegin(); m_lodBlock > 1 && it != m_impostors.rend(); ++it)
+	{
+		auto& patch = it->second;
+		if (!patch.vertices || patch.vertices->empty() || !visibleArea.findIntersection(patch.bounds)) continue;
+		frame.impostors.push_back(patch.vertices);
+	}
+
+	// terrain is already bucketed in draw order, so only the actors need sorting; clips are
+	// immutable once loaded, so the frame can point straight at them
+	auto& assets = m_game->assets();
+	for (Entity e : m_entityManager.getEntities())
+	{
+		if (!e.has<CAnimation>(m_memoryPool) || !e.has<CGridPosition>(m_memoryPool) || !e.has<CTransform>(m_memoryPool)) continue;
+
+		auto& animation = e.get<CAnimation>(m_memoryPool);
+		auto& clip = assets.getAnimation(animation.clip);
+		sf::Vector2f topLeft = sf::Vector2f(interpolatedPos(e.get<CTransform>(m_memoryPool))) - sf::Vector2f(clip.m_size) / 2.f;
+		if (!visibleArea.findIntersection(sf::FloatRect(topLeft, clip.m_size))) continue;
+
+		// the frame is a function of the tick count alone, so it is only worked out here
+		size_t shownFrame = clip.frameAt(m_currentFrame - animation.startTick, animation.repeat);
+		frame.actors.push_back({ e.get<CGridPosition>(m_memoryPool).pos, topLeft, &clip, shownFrame });
+	}
+	std::sort(frame.actors.begin(), frame.actors.end(), [](const RenderActor& a, const RenderActor& b)
+	{
+		return std::make_tuple(b.pos.z, b.pos.x + b.pos.y) < std::make_tuple(a.pos.z, a.pos.x + a.pos.y);
+	});
+
+	auto& pGridPos = player().get<CGridPosition>(m_memoryPool);
+	frame.cutaway = m_cutaway;
+	frame.cutawayLevel = int(std::floor(pGridPos.pos.z));
+	frame.lodBlock = m_lodBlock;
+	frame.simulationSpeed = m_game->simulationSpeed();
+	frame.showOverlay = m_showDebugOverlay;
+	if (m_showDebugOverlay)
+	{
+		frame.playerPos = pGridPos.pos;
+		frame.playerChunk = Utils::gridToChunkPos(pGridPos, m_chunkSize3D);
+		frame.numTiles = 0;
+		for (Entity chunk : m_entityManager.getEntities("chunk"))
+		{
+			frame.numTiles += chunk.get<CChunkTiles>(m_memoryPool).tiles.size();
+		}
+		int loadSide = 2 * m_loadRadius + 1;
+		frame.numChunks = m_chunkMap.size();
+		frame.numSkipped = m_skippedChunks.size();
+		frame.numPending = std::max(0, loadSide * loadSide * loadSide - int(m_chunkMap.size() + m_skippedChunks.size()));
+		frame.numEntities = m_entityManager.getEntities().size();
+	}
+	frame.ready = true;
+}
+
+void Scene_Play::publishFrame()
+{
+	// called between simulation passes, so neither frame is being written; the old front
+	// frame has been drawn, so it lets go of its meshes and only the new front one holds any
+	m_frontFrame = 1 - m_frontFrame;
+	auto& back = m_frames[1 - m_frontFrame];
+	back.regions.clear();
+	back.impostors.clear();
+}
+
 void Scene_Play::sRender()
 {
 	auto& window = m_game->window();
 	sf::Color clearColor = sf::Color(204, 226, 225);
 	window.clear(clearColor);
 
-	static const float RENDER_DIST = 100.0f;
-	static const float RENDER_DIST_SQUARED = RENDER_DIST * RENDER_DIST;
+	// only the front frame is read here; the simulation owns everything else meanwhile
+	auto& frame = m_frames[m_frontFrame];
+	if (!frame.ready) return;
+
+	window.setView(frame.view);
+	m_renderStats = frame.stats;
 
-	auto& pGridPos = player().get<CGridPosition>(m_memoryPool).pos;
-	for (auto it = m_chunkMap.rbegin(); it != m_chunkMap.rend(); ++it)
+	// every chunk in a region shares the tile atlas page
+	const sf::Texture& tileset = *m_tileTexture;
+	for (auto& vertices : frame.impostors)
 	{
-		/*auto& cGridPos = chunk.get<CGridPosition>(m_memoryPool).pos;
-		if (pGridPos.distToSquared(cGridPos) > RENDER_DIST_SQUARED) continue;*/
-		
-		auto& chunk = it->second;
-		auto& chunkVertexArray = chunk.get<CVertexArray>(m_memoryPool).va;
-		window.draw(chunkVertexArray, &m_game->assets().getTexture("TexTiles"));
+		window.draw(vertices->data(), vertices->size(), sf::PrimitiveType::Triangles, &tileset);
+		m_renderStats.vertices += vertices->size();
+		m_renderStats.drawCalls++;
 	}
 
-	auto& animation = player().get<CAnimation>(m_memoryPool).animation;
-	window.draw(animation.m_sprite);
+	// each actor is drawn after every visible bucket behind it and before the ones in front;
+	// the cutaway hides every layer above the player by drawing only a prefix of each mesh,
+	// and actors with no terrain between them go out in the same sprite batch
+	m_regionDrawn.assign(frame.regions.size(), 0);
+	for (size_t a = 0; a <= frame.actors.size(); ++a)
+	{
+		bool last = a == frame.actors.size();
+		for (size_t r = 0; r < frame.regions.size(); ++r)
+		{
+			auto& mesh = *frame.regions[r];
+			size_t& drawn = m_regionDrawn[r];
+			size_t end = last ? mesh.buckets.starts.back() : mesh.buckets.split(frame.actors[a].pos);
+			if (frame.cutaway) end = std::min(end, mesh.buckets.layerEnd(frame.cutawayLevel));
+			if (end <= drawn) continue;
+
+			m_renderStats.drawCalls += m_spriteBatch.flush(window);
+			window.draw(&mesh.vertices[drawn], end - drawn, sf::PrimitiveType::Triangles, &tileset);
+			m_renderStats.vertices += end - drawn;
+			m_renderStats.drawCalls++;
+			drawn = end;
+		}
+
+		if (last) break;
+		auto& actor = frame.actors[a];
+		m_renderStats.drawCalls += m_spriteBatch.add(window, *actor.clip->m_texture, actor.clip->frameRect(actor.frame), actor.topLeft);
+		m_renderStats.sprites++;
+	}
+	m_renderStats.drawCalls += m_spriteBatch.flush(window);
 
 	window.setView(window.getDefaultView());
 
-	sf::Text pGridPosText(m_game->assets().getFont("FutureMillennium"), pGridPos.toString());
-	window.draw(pGridPosText);
+	updateDebugOverlay(frame);
+	m_debugOverlay.draw(window);
 
-	sf::Text cPosText(m_game->assets().getFont("FutureMillennium"),
-		Utils::gridToChunkPos(pGridPos, m_chunkSize3D).toString());
-	cPosText.setPosition(sf::Vector2f(0, height() * 0.05f));
-	window.draw(cPosText);
+	window.setView(frame.view);
+}
 
-	window.setView(m_cameraView);
+void Scene_Play::updateDebugOverlay(const RenderFrame& frame)
+{
+	m_debugOverlay.recordFrame();
+	m_debugOverlay.m_visible = frame.showOverlay;
+	if (!m_debugOverlay.m_visible) return;
+
+	auto& pGridPos = frame.playerPos;
+	auto& chunkPos = frame.playerChunk;
+	auto& timings = m_debugOverlay.frameTimes();
+	auto& stats = m_renderStats;
+	m_debugOverlay.setLine(0, "pos (%.1f, %.1f, %.1f)  chunk (%d, %d, %d)",
+		pGridPos.x, pGridPos.y, pGridPos.z, int(chunkPos.x), int(chunkPos.y), int(chunkPos.z));
+	m_debugOverlay.setLine(1, "frame p50 %.2f ms  p95 %.2f ms  p99 %.2f ms  max %.2f ms",
+		timings.p50, timings.p95, timings.p99, timings.max);
+	m_debugOverlay.setLine(2, "chunks %zu loaded, %d pending, %zu skipped  tiles %zu  entities %zu",
+		frame.numChunks, frame.numPending, frame.numSkipped, frame.numTiles, frame.numEntities);
+	m_debugOverlay.setLine(3, "draw %zu chunks, %zu culled  %zu vertices  %zu draw calls  %zu sprites  %zu expanded",
+		stats.chunksDrawn, stats.chunksCulled, stats.vertices, stats.drawCalls, stats.sprites, stats.meshesExpanded);
+	m_debugOverlay.setLine(4, "cutaway %s (z %d)  lod %dx%d  speed x%zu",
+		frame.cutaway ? "on" : "off", frame.cutawayLevel, frame.lodBlock, frame.lodBlock, frame.simulationSpeed);
+
+	// resident mesh memory against expanding every loaded chunk, the layout before packed tiles
+	const float mb = 1024.0f * 1024.0f;
+	size_t packedBytes = frame.numTiles * sizeof(Tile);
+	size_t allExpandedBytes = frame.numTiles * 6 * sizeof(sf::Vertex);
+	m_debugOverlay.setLine(5, "meshes %.1f MB expanded + %.1f MB packed, %.1fx less than %.1f MB fully expanded",
+		stats.meshBytes / mb, packedBytes / mb, allExpandedBytes / float(std::max<size_t>(stats.meshBytes + packedBytes, 1)),
+		allExpandedBytes / mb);
 }
 
-void Scene_Play::buildVertexArrayForChunk(CVertexArray& cVa, CChunkTiles& tileChunk, const sf::Texture& tileset)
+void Scene_Play::expandRegions(const std::vector<RegionBatch*>& regions) const
 {
-	auto& tiles = tileChunk.tiles;
-	sf::VertexArray& va = cVa.va;
-	va.setPrimitiveType(sf::PrimitiveType::Triangles);
+	// every region writes its own buffer, so the jobs are independent
+	WorkerPool::shared().parallelFor(regions.size(), [&](size_t j) { expandRegion(*regions[j]); });
+}
 
-	for (int i = tiles.size() - 1; i >= 0; --i)
+void Scene_Play::writeTileVertices(sf::Vertex* out, const Tile* tiles, size_t count, const Grid3D& origin) const
+{
+	for (size_t t = 0; t < count; ++t)
 	{
-		Entity& tile = tiles[i];
-		auto& tileGridPos = tile.get<CGridPosition>(m_memoryPool).pos;
-
-		// Optionally skip tiles that are fully enclosed
-		/*if (m_tileMap.find(tileGridPos + Grid3D(1, 1, 1)) != m_tileMap.end())
-			continue;*/
-
-		auto& tileInfo = tile.get<CTileRenderInfo>(m_memoryPool);
-		const sf::Vector2f& pos = tileInfo.position;
-		const sf::Vector2f origin = m_gridCellSize / 2.f;
-		const sf::IntRect& texRect = tileInfo.textureRect;
-
-		// Vertex positions in world space
-		sf::Vector2f topLeft = pos - origin;
-		sf::Vector2f topRight = { topLeft.x + texRect.size.x, topLeft.y };
-		sf::Vector2f bottomRight = { topLeft.x + texRect.size.x, topLeft.y + texRect.size.y };
-		sf::Vector2f bottomLeft = { topLeft.x, topLeft.y + texRect.size.y };
+		const Tile& tile = tiles[t];
+		Grid3D gridPos(origin.x + tile.x, origin.y + tile.y, origin.z + tile.z);
+		sf::Vector2f pos = Utils::gridToIsometric(gridPos, m_gridCellSize);
+		auto& uvs = m_tileUVs[size_t(tile.material)];
 
-		// Texture coordinates
-		sf::Vector2f texTopLeft(texRect.position.x, texRect.position.y);
-		sf::Vector2f texTopRight(texRect.position.x + texRect.size.x, texRect.position.y);
-		sf::Vector2f texBottomRight(texRect.position.x + texRect.size.x, texRect.position.y + texRect.size.y);
-		sf::Vector2f texBottomLeft(texRect.position.x, texRect.position.y + texRect.size.y);
-
-		// First triangle
-		va.append(sf::Vertex({ topLeft, sf::Color::White, texTopLeft }));
-		va.append(sf::Vertex({ topRight, sf::Color::White, texTopRight }));
-		va.append(sf::Vertex({ bottomRight, sf::Color::White, texBottomRight }));
-
-		// Second triangle
-		va.append(sf::Vertex({ bottomRight, sf::Color::White, texBottomRight }));
-		va.append(sf::Vertex({ bottomLeft, sf::Color::White, texBottomLeft }));
-		va.append(sf::Vertex({ topLeft, sf::Color::White, texTopLeft }));
+		sf::Vertex* quad = out + t * 6;
+		for (size_t v = 0; v < 6; ++v)
+		{
+			quad[v].position = pos + m_tileCorners[v];
+			quad[v].color = sf::Color::White;
+			quad[v].texCoords = uvs[v];
+		}
 	}
-}
+}
\ No newline at end of file
@@ -4,16 +4,138 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <array>
 
 #include "Grid3D.hpp"
 #include "EntityManager.hpp"
 #include "ParticleSystem.hpp"
+#include "PerlinNoise.hpp"
+#include "SpriteBatch.hpp"
+#include "DebugOverlay.hpp"
 
-using TileMap = std::map<Grid3D, Entity>;
-using TileSet = std::set<Grid3D>;
 using ChunkMap = std::map<Grid3D, Entity>;
 using HeightMap = std::vector<float>;
 
+enum class TerrainMode { HeightMap, Density };
+enum class ChunkFill { Empty, Solid, Mixed };
+using ChunkFillMap = std::map<Grid3D, ChunkFill>;
+
+namespace PlayAction
+{
+	enum : ActionId
+	{
+		Left = EngineAction::SceneFirst,
+		Right,
+		Up,
+		Down,
+		Forward,
+		Backward,
+		Escape,
+		ToggleTerrain,
+		Benchmark,
+		ToggleCutaway,
+		FastForward,
+		ToggleOverlay,
+		LeftClick,
+		RightClick
+	};
+}
+
+struct RenderStats
+{
+	size_t chunksDrawn = 0;
+	size_t chunksCulled = 0;
+	size_t vertices = 0;
+	size_t drawCalls = 0;
+	size_t meshesExpanded = 0;
+	size_t meshBytes = 0; // region vertex buffers allocated, including the pool
+	size_t sprites = 0;
+};
+
+struct RegionMember
+{
+	const CChunkTiles* tiles = nullptr;
+	Grid3D origin;
+	sf::FloatRect bounds;
+	bool visible = false; // passed this frame's view test, so it is in the region's layout
+};
+
+// expanded vertices together with the bucket layout they were written in; render frames
+// share them, so a mesh is never written again once a frame has picked it up
+struct RegionMesh
+{
+	std::vector<sf::Vertex> vertices;
+	TileBuckets buckets;
+};
+
+// block of neighbouring chunks drawn as one mesh, in the same bucket layout as CChunkTiles;
+// only the member chunks in view are laid out and expanded from their packed tiles
+struct RegionBatch
+{
+	std::vector<RegionMember> members; // grouped by chunk layer, bottom first
+	std::vector<size_t> slabStarts;
+	Grid3D minPos; // grid position of the region's first tile
+	TileBuckets buckets; // in vertices, visible members only
+	sf::FloatRect bounds; // of all members
+	size_t numChunks = 0;
+	std::shared_ptr<RegionMesh> mesh;
+	bool expanded = false;
+	size_t lastVisible = 0;
+};
+
+// coarse stand-in for a square patch of heightmap columns, one scaled tile cube per
+// block of columns, drawn instead of the chunk meshes when the view is zoomed far out
+struct ImpostorPatch
+{
+	std::shared_ptr<const std::vector<sf::Vertex>> vertices;
+	sf::FloatRect bounds;
+};
+
+using ImpostorMap = std::map<Grid3D, ImpostorPatch>;
+
+struct RenderActor
+{
+	Grid3D pos;
+	sf::Vector2f topLeft; // at its interpolated position
+	const AnimationClip* clip = nullptr;
+	size_t frame = 0;
+};
+
+// everything sRender needs for one frame, captured by the simulation thread once that
+// frame's ticks are done; two of these alternate so the one being drawn is never written
+struct RenderFrame
+{
+	bool ready = false;
+	sf::View view;
+	std::vector<std::shared_ptr<const RegionMesh>> regions; // visible, back to front
+	std::vector<std::shared_ptr<const std::vector<sf::Vertex>>> impostors;
+	std::vector<RenderActor> actors; // visible, back to front
+	bool cutaway = false;
+	int cutawayLevel = 0;
+	int lodBlock = 1;
+	size_t simulationSpeed = 1;
+	RenderStats stats; // culling and meshing; drawing adds the rest
+	bool showOverlay = true;
+	Grid3D playerPos;
+	Grid3D playerChunk;
+	size_t numTiles = 0;
+	size_t numChunks = 0;
+	size_t numSkipped = 0;
+	int numPending = 0;
+	size_t numEntities = 0;
+};
+
+using RegionMap = std::map<Grid3D, RegionBatch>;
+using RegionSet = std::set<Grid3D>;
+
+using TileUVs = std::array<std::array<sf::Vector2f, 6>, size_t(TileMaterial::Count)>;
+
+struct ChunkColumnBounds
+{
+	int minHeight = 0; // highest surface inside the chunk column
+	int maxHeight = 0; // lowest surface inside the column and its -x/-y border
+};
+
 class Scene_Play : public Scene
 {
 public:
@@ -27,35 +149,83 @@ public:
 	Grid3D   				 m_gridSize3D = { 1000, 1000, 50 };
 	Grid3D					 m_chunkSize3D = { 32, 32, 32 };
 	Grid3D					 m_numChunks3D = { 4, 4, 4 };
-	TileMap					 m_tileMap;
-	TileSet					 m_tileSet;
 	ChunkMap				 m_chunkMap;
+	Grid3D					 m_regionSize3D = { 4, 4, 4 };
+	RegionMap				 m_regionMap;
+	RegionSet				 m_dirtyRegions;
+	ChunkFillMap			 m_skippedChunks;
+	std::vector<ChunkColumnBounds> m_chunkColumnBounds;
 	int						 m_loadRadius = 3;
-	bool					 m_chunkChanged = false;
 	HeightMap				 m_heightMap;
 	int						 m_waterLevel = 20;
+	TerrainMode				 m_terrainMode = TerrainMode::HeightMap;
+	bool					 m_coarseDensity = true;
+	int						 m_densityStep = 4;
+	int						 m_densityCell = 16;
+	int						 m_densityOctaves = 3;
+	float					 m_densityAmplitude = 8.0f;
+	uint64_t				 m_terrainSeed = 0;
+	NoiseVolume				 m_densityScratch;
+	TileUVs					 m_tileUVs;
+	const sf::Texture*		 m_tileTexture = nullptr;
+	std::array<sf::Vector2f, 6> m_tileCorners;
+	RenderStats				 m_renderStats;
+	std::vector<Tile>		 m_tileScratch;
+	std::vector<RegionBatch*> m_visibleRegions;
+	std::vector<RegionBatch*> m_expandQueue;
+	std::vector<std::shared_ptr<RegionMesh>> m_meshPool; // at most one per visible region
+	std::vector<std::shared_ptr<RegionMesh>> m_retiredMeshes; // released while still drawn
+	std::array<RenderFrame, 2> m_frames;
+	size_t					 m_frontFrame = 0;
+	std::vector<size_t>		 m_regionDrawn;
+	SpriteBatch				 m_spriteBatch;
+	DebugOverlay			 m_debugOverlay;
+	bool					 m_showDebugOverlay = true;
+	bool					 m_cutaway = false;
+	ImpostorMap				 m_impostors;
+	int						 m_impostorPatchSize = 128;
+	int						 m_lodBlock = 1;
+	size_t					 m_fastForwardSpeed = 16; // gameplay ticks per fixed tick while fast-forwarding
 
 	void init(const std::string& levelPath);
+	void registerActions();
 	void loadLevel(const std::string& filename);
 	void generateHeightMap();
+	void computeChunkColumnBounds();
+	void computeChunkColumnBounds(int cx, int cy);
+	int columnHeight(int x, int y) const;
+	int exposedEnd(int x, int y) const;
+	ChunkFill classifyChunk(const Grid3D& chunkPos) const;
 
 	void onEnd();
 	void onEnterScene();
 	void onExitScene();
+	void returnToMenu();
 	void update();
 	void spawnPlayer();
 	Entity spawnChunk(const Grid3D& chunkPos);
 	void spawnTilesFromChunk(CGridPosition& chunkPos, CChunkTiles& chunkTiles);
-	void spawnTiles();
-	Entity spawnTile(Grid3D& chunkPos);
+	void spawnTilesFromHeightMap(CGridPosition& chunkPos, CChunkTiles& chunkTiles);
+	void spawnTilesFromDensity(CGridPosition& chunkPos, CChunkTiles& chunkTiles);
+	void bucketTiles(CChunkTiles& chunkTiles);
+	void benchmarkChunkGeneration();
+	TileMaterial tileMaterial(int z) const;
+	Tile makeTile(const Grid3D& origin, int x, int y, int z) const;
+	void buildTileMeshTables();
+
+	void digColumn(int x, int y);
+	void raiseColumn(int x, int y);
+	void setColumnHeight(int x, int y, int height);
+	bool pickColumn(const Vec2f& worldPos, Grid3D& columnTop) const;
+	void addTerrainTile(const Grid3D& gridPos);
+	void removeTerrainTile(const Grid3D& gridPos);
+	void shiftTileBuckets(CChunkTiles& chunkTiles, const Tile& tile, int count);
 
 	Entity player();
-	void sDoAction(const Action& action);
 
 	void sMovement();
 	void sAI();
 	void sStatus();
-	void sAnimation();
 	void sCollision();
 	void sCamera();
 	void sGui();
@@ -63,11 +233,36 @@ public:
 
 	void spawnChunks();
 	void despawnChunks();
+	void despawnChunk(Entity chunk);
+	void despawnAllChunks();
 
 	Scene_Play() = default;
 	Scene_Play(GameEngine* gameEngine, const std::string& levelPath = "");
 
 	void sRender();
-	void buildVertexArrayForChunk(CVertexArray& cVa, CChunkTiles& tileChunk, const sf::Texture& tileset);
-	void buildVertexArraysForChunks();
+	void prepareFrame();
+	void publishFrame();
+	Vec2f interpolatedPos(const CTransform& transform) const;
+	void updateDebugOverlay(const RenderFrame& frame);
+	void writeTileVertices(sf::Vertex* out, const Tile* tiles, size_t count, const Grid3D& origin) const;
+	void markRegionDirty(const Grid3D& chunkPos);
+	void buildRegionBatches();
+	void layoutRegion(RegionBatch& region);
+	size_t cullRegionMembers(RegionBatch& region, const sf::FloatRect& visibleArea);
+	template <typename F>
+	void forEachRegionSegment(const RegionBatch& region, F&& fn) const;
+	void expandRegion(RegionBatch& region) const;
+	void expandRegions(const std::vector<RegionBatch*>& regions) const;
+	size_t expandVisibleRegions();
+	std::shared_ptr<RegionMesh> takeRegionMesh();
+	void prepareRegionMesh(RegionBatch& region);
+	void patchRegionMesh(const Grid3D& chunkPos, const CChunkTiles& chunkTiles, const Tile& tile, size_t tileIndex, int count);
+	void releaseRegionMesh(RegionBatch& region);
+	void recycleRegionMesh(std::shared_ptr<RegionMesh> mesh);
+	size_t residentMeshBytes() const;
+	int lodBlockSize() const;
+	void buildImpostors();
+	void buildImpostorPatch(const Grid3D& patchPos, ImpostorPatch& patch) const;
+	sf::FloatRect impostorPatchBounds(const Grid3D& patchPos) const;
+	void invalidateImpostors(int x, int y);
 };
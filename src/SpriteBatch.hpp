@@ -0,0 +1,47 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cmath>
+
+// collects sprite frames into one triangle list per texture page; consecutive frames on the same
+// page cost a single draw call, and a page switch or an explicit flush submits the batch
+class SpriteBatch
+{
+	std::vector<sf::Vertex> m_vertices;
+	const sf::Texture* m_texture = nullptr;
+
+public:
+	SpriteBatch() = default;
+
+	// an unrotated, unscaled frame with its top-left corner at position; returns the number
+	// of draw calls issued, so callers can keep their stats
+	size_t add(sf::RenderTarget& target, const sf::Texture& texture, const sf::IntRect& rect, const sf::Vector2f& position)
+	{
+		size_t drawCalls = 0;
+		if (&texture != m_texture)
+		{
+			drawCalls = flush(target);
+			m_texture = &texture;
+		}
+
+		sf::FloatRect uvRect(rect);
+		const sf::Vector2f corners[] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 1, 1 }, { 0, 1 }, { 0, 0 } };
+		for (auto& corner : corners)
+		{
+			sf::Vector2f local(corner.x * std::abs(uvRect.size.x), corner.y * std::abs(uvRect.size.y));
+			sf::Vector2f uv(uvRect.position.x + corner.x * uvRect.size.x, uvRect.position.y + corner.y * uvRect.size.y);
+			m_vertices.push_back({ position + local, sf::Color::White, uv });
+		}
+		return drawCalls;
+	}
+
+	size_t flush(sf::RenderTarget& target)
+	{
+		if (m_vertices.empty()) return 0;
+
+		target.draw(m_vertices.data(), m_vertices.size(), sf::PrimitiveType::Triangles, m_texture);
+		m_vertices.clear(); // keeps its capacity for the next frame
+		return 1;
+	}
+};
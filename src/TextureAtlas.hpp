@@ -0,0 +1,106 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+// shelf bin-packer for texture atlas pages: rectangles are placed tallest first, left to
+// right along shelves opened top to bottom, and a new page is started once nothing fits
+class TextureAtlas
+{
+public:
+	struct Region
+	{
+		size_t page = 0;
+		sf::IntRect rect;
+	};
+
+	struct Shelf
+	{
+		int y = 0;
+		int height = 0;
+		int x = 0;
+	};
+
+	struct Page
+	{
+		sf::Vector2i size;
+		std::vector<Shelf> shelves;
+		int usedHeight = 0;
+	};
+
+	std::vector<Page> m_pages;
+	int m_pageSize = 2048;
+	int m_padding = 1; // transparent gutter so neighbouring frames never bleed into each other
+
+	TextureAtlas() = default;
+	TextureAtlas(int pageSize, int padding)
+		: m_pageSize(pageSize), m_padding(padding) {}
+
+	// regions come back in the order of the sizes passed in
+	std::vector<Region> pack(const std::vector<sf::Vector2u>& sizes)
+	{
+		std::vector<size_t> order(sizes.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+		{
+			return sizes[a].y > sizes[b].y;
+		});
+
+		std::vector<Region> regions(sizes.size());
+		for (size_t i : order)
+		{
+			regions[i] = place(sf::Vector2i(sizes[i]));
+		}
+		return regions;
+	}
+
+	// size actually covered on a page, so the last page need not be a full square
+	sf::Vector2u pageSize(size_t page) const
+	{
+		auto& p = m_pages[page];
+		return sf::Vector2u(unsigned(p.size.x), unsigned(std::min(p.size.y, p.usedHeight)));
+	}
+
+private:
+	Region place(const sf::Vector2i& size)
+	{
+		int w = size.x + m_padding, h = size.y + m_padding;
+
+		// anything larger than a page gets a page of its own
+		if (w > m_pageSize || h > m_pageSize)
+		{
+			m_pages.push_back({ size, {}, size.y });
+			return { m_pages.size() - 1, sf::IntRect({ 0, 0 }, size) };
+		}
+
+		for (size_t p = 0; p < m_pages.size(); ++p)
+		{
+			auto& page = m_pages[p];
+			for (auto& shelf : page.shelves)
+			{
+				if (h > shelf.height || shelf.x + w > page.size.x) continue;
+
+				sf::IntRect rect({ shelf.x, shelf.y }, size);
+				shelf.x += w;
+				return { p, rect };
+			}
+
+			if (page.usedHeight + h <= page.size.y && w <= page.size.x)
+			{
+				return { p, openShelf(page, size, w, h) };
+			}
+		}
+
+		m_pages.push_back({ { m_pageSize, m_pageSize }, {}, 0 });
+		return { m_pages.size() - 1, openShelf(m_pages.back(), size, w, h) };
+	}
+
+	sf::IntRect openShelf(Page& page, const sf::Vector2i& size, int w, int h)
+	{
+		page.shelves.push_back({ page.usedHeight, h, w });
+		page.usedHeight += h;
+		return sf::IntRect({ 0, page.shelves.back().y }, size);
+	}
+};
@@ -4,6 +4,7 @@
 #include "Entity.hpp"
 #include "Components.hpp"
 #include "Grid3D.hpp"
+#include <cfloat>
 
 class Utils
 {
@@ -37,14 +38,6 @@ public:
 		return lehmer64(seed);
 	}
 
-	static bool isBehindAnotherTile(const CGridPosition& cGridPos, const TileMap& tileMap)
-	{
-		auto& gridPos = cGridPos.pos;
-		if (tileMap.find(gridPos - Grid3D(1, 1, 1)) == tileMap.end())
-			return false;
-		return true;
-	}
-
 	static sf::FloatRect visibleArea(const sf::View& cameraView)
 	{
 		const float padding = 128.0f;
@@ -54,17 +47,36 @@ public:
 		return visibleArea;
 	}
 
+	// screen rectangle covering every tile sprite with grid position in [minPos, maxPos]
+	static sf::FloatRect isometricBounds(const Grid3D& minPos, const Grid3D& maxPos, const Vec2f& size)
+	{
+		sf::Vector2f lo(FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			Grid3D p((corner & 1) ? maxPos.x : minPos.x,
+				(corner & 2) ? maxPos.y : minPos.y,
+				(corner & 4) ? maxPos.z : minPos.z);
+			sf::Vector2f iso = gridToIsometric(p, size);
+			lo.x = std::min(lo.x, iso.x); lo.y = std::min(lo.y, iso.y);
+			hi.x = std::max(hi.x, iso.x); hi.y = std::max(hi.y, iso.y);
+		}
+
+		// tile sprites are centred on their projected position
+		sf::Vector2f half = sf::Vector2f(size) / 2.f;
+		return sf::FloatRect(lo - half, hi - lo + half * 2.f);
+	}
+
 	static bool isVisible(const CTransform& eTransform, const sf::FloatRect& visibleArea)
 	{
 		auto& pos = eTransform.pos;
 		return visibleArea.contains(pos);
 	}
 
-	bool static isInsideTopFace(const Vec2f& pos, const CTransform& eTransform, const CAnimation& eAnimation)
+	bool static isInsideTopFace(const Vec2f& pos, const CTransform& eTransform, const AnimationClip& clip)
 	{
 		Vec2f spriteCenter = eTransform.pos; // center of entire sprite
 		Vec2f scale = eTransform.scale;
-		Vec2f size = eAnimation.animation.m_size;
+		Vec2f size = clip.m_size;
 
 		// Apply scale
 		size.x *= scale.x;
@@ -84,12 +96,12 @@ public:
 		return (dx / halfWidth + dy / halfHeight) <= 1.0f;
 	}
 
-	bool static isInside(const Vec2f& point, const CTransform& eTransform, const CAnimation& eAnimation)
+	bool static isInside(const Vec2f& point, const CTransform& eTransform, const AnimationClip& clip)
 	{
 		const Vec2f& center = eTransform.pos;
 		const Vec2f& scale = eTransform.scale;
 
-		Vec2f size = eAnimation.animation.m_size;
+		Vec2f size = clip.m_size;
 		size.x *= scale.x;
 		size.y *= scale.y;
 
@@ -102,9 +114,9 @@ public:
 			point.y >= top && point.y <= bottom);
 	}
 
-	Vec2f static gridToIsometric(Grid3D& gridPos, const CAnimation& eAnimation)
+	Vec2f static gridToIsometric(Grid3D& gridPos, const AnimationClip& clip)
 	{
-		Vec2f eSize = eAnimation.animation.m_size;
+		Vec2f eSize = clip.m_size;
 
 		Vec2f i = Vec2f(eSize.x / 2, 0.5f * eSize.y / 2) * -1;
 		Vec2f j = Vec2f(-eSize.x / 2, 0.5f * eSize.y / 2) * -1;
@@ -120,13 +132,14 @@ public:
 		return (i * gridPos.x + j * gridPos.y) + Vec2f(0, gridPos.z * size.y / 2);
 	}
 
+	// inverse of gridToIsometric for a known z level
 	Vec2f static isometricToGrid(float isoX, float isoY, int z, Vec2f gridCellSize)
 	{
-		Vec2f i = Vec2f(gridCellSize.x / 2, 0.5f * gridCellSize.y / 2);
-		Vec2f j = Vec2f(-gridCellSize.x / 2, 0.5f * gridCellSize.y / 2);
+		Vec2f i = Vec2f(gridCellSize.x / 2, 0.5f * gridCellSize.y / 2) * -1;
+		Vec2f j = Vec2f(-gridCellSize.x / 2, 0.5f * gridCellSize.y / 2) * -1;
 
 		// Apply inverse Z offset
-		isoY += z * (gridCellSize.y / 2);
+		isoY -= z * (gridCellSize.y / 2);
 
 		float a = i.x, b = j.x;
 		float c = i.y, d = j.y;
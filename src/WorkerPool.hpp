@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// threads started once and parked between jobs, so per-frame parallel work costs a wake-up
+// rather than creating and joining threads every time
+class WorkerPool
+{
+	std::vector<std::thread> m_threads;
+	std::mutex m_callMutex; // one parallelFor at a time
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	const std::function<void(size_t)>* m_job = nullptr;
+	size_t m_count = 0;
+	std::atomic<size_t> m_next = 0;
+	size_t m_generation = 0;
+	size_t m_active = 0;
+	bool m_stop = false;
+
+	void runJobs()
+	{
+		for (size_t j = m_next++; j < m_count; j = m_next++)
+		{
+			(*m_job)(j);
+		}
+	}
+
+	void workerLoop()
+	{
+		size_t seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [&]() { return m_stop || m_generation != seen; });
+				if (m_stop) return;
+				seen = m_generation;
+			}
+			runJobs();
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_active == 0) m_done.notify_one();
+		}
+	}
+
+public:
+	explicit WorkerPool(size_t numThreads)
+	{
+		for (size_t t = 0; t < numThreads; ++t) m_threads.emplace_back([this]() { workerLoop(); });
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for (auto& thread : m_threads) thread.join();
+	}
+
+	// one pool for the whole process; the calling thread works too, so it has one thread
+	// fewer than the hardware has
+	static WorkerPool& shared()
+	{
+		static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+		return pool;
+	}
+
+	size_t numThreads() const
+	{
+		return m_threads.size() + 1;
+	}
+
+	// calls fn(j) for every j in [0, count) across the pool and the caller, and returns once
+	// all of them are done; jobs are handed out through one counter, so they should be
+	// independent of each other
+	void parallelFor(size_t count, const std::function<void(size_t)>& fn)
+	{
+		if (m_threads.empty() || count <= 1)
+		{
+			for (size_t j = 0; j < count; ++j) fn(j);
+			return;
+		}
+
+		std::lock_guard<std::mutex> call(m_callMutex);
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &fn;
+			m_count = count;
+			m_next = 0;
+			m_active = m_threads.size();
+			m_generation++;
+		}
+		m_wake.notify_all();
+		runJobs();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [&]() { return m_active == 0; });
+		m_job = nullptr;
+	}
+};
+
+// a single long-lived thread that runs one handed-over job at a time, for work that
+// overlaps the caller every frame, like the pipelined simulation
+class TaskThread
+{
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	std::function<void()> m_job;
+	std::exception_ptr m_error;
+	bool m_busy = false;
+	bool m_stop = false;
+	std::thread m_thread; // last, so it starts once everything it uses is constructed
+
+	void threadLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [&]() { return m_stop || m_job; });
+				if (!m_job) return;
+				job = std::move(m_job);
+				m_job = nullptr;
+			}
+
+			std::exception_ptr error;
+			try
+			{
+				job();
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_error = error;
+			m_busy = false;
+			m_done.notify_all();
+		}
+	}
+
+public:
+	TaskThread()
+		: m_thread([this]() { threadLoop(); }) { }
+
+	TaskThread(const TaskThread&) = delete;
+	TaskThread& operator=(const TaskThread&) = delete;
+
+	~TaskThread()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_done.wait(lock, [&]() { return !m_busy; });
+			m_stop = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+
+	// hands a job over once the previous one has finished
+	void submit(std::function<void()> job)
+	{
+		wait();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = std::move(job);
+			m_busy = true;
+		}
+		m_wake.notify_one();
+	}
+
+	// blocks until the current job is done and rethrows anything it threw
+	void wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [&]() { return !m_busy; });
+		if (m_error) std::rethrow_exception(std::exchange(m_error, nullptr));
+	}
+};
@@ -3,8 +3,24 @@
 
 #include "GameEngine.h"
 
-int main()
+#include <string>
+
+int main(int argc, char* argv[])
 {
-    GameEngine g("assets/assets.txt");
+    // --pack [manifest] writes the asset bundle the game loads in place of the loose files
+    if (argc > 1 && std::string(argv[1]) == "--pack")
+    {
+        std::string manifest = argc > 2 ? argv[2] : "assets/assets.txt";
+        return Assets::writeBundle(manifest, Assets::bundlePath(manifest)) ? 0 : 1;
+    }
+
+    // --seed <n> replays a run with the seed it printed at startup
+    std::optional<uint64_t> seed;
+    if (argc > 2 && std::string(argv[1]) == "--seed")
+    {
+        seed = std::stoull(argv[2]);
+    }
+
+    GameEngine g("assets/assets.txt", seed);
     g.run();
-}
\ No newline at end of file
+}